@@ -0,0 +1,344 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include "batch.hpp"
+#include "heuristic.hpp"
+#include "problem.hpp"
+#include "report.hpp"
+#include "colonies/registry.hpp"
+
+namespace {
+	std::string json_string(const std::string& str) {
+		std::string result = "\"";
+		for (char c : str) {
+			if (c == '"' || c == '\\') { result += '\\'; }
+			result += c;
+		}
+		return result + "\"";
+	}
+
+	bool is_auto(const std::string& threads) {
+		return threads == "auto" || threads == "cores" || threads == "native";
+	}
+
+	/*
+		Thread count or batch size given in a colony spec, throws std::invalid_argument unless it is at least 1
+	*/
+	int positive_count(const std::string& value) {
+		const int count = std::stoi(value);
+		if (count < 1) { throw std::invalid_argument("count below 1: " + value); }
+		return count;
+	}
+
+	struct ProblemEntry {
+		std::filesystem::path path;
+		uintmax_t file_size = 0;
+
+		std::mutex mutex;
+		std::unique_ptr<LoadedProblem> loaded;
+		// Jobs not finished yet, the problem is released after the last
+		int remaining = 0;
+	};
+
+	struct Job {
+		ProblemEntry* problem;
+		std::string colony;
+		unsigned int seed;
+		int rounds;
+	};
+
+	void print_result(const BatchResult& result) {
+		std::cout.precision(4);
+		std::cout
+			<< "[" << result.problem << "] "
+			<< result.colony << " seed=" << result.seed << " rounds=" << result.rounds << " : best "
+			<< result.best_length;
+		if (result.gap >= 0) {
+			std::cout << " (gap " << result.gap * 100 << "%)";
+		}
+		std::cout << " in " << result.total << "ms on " << result.threads << (result.threads == 1 ? " thread" : " threads") << std::endl;
+	}
+}
+
+LoadedProblem::LoadedProblem(Problem loaded)
+	: problem(std::move(loaded)),
+	ants(default_ant_count(problem), Ant(0)),
+	initial_route(nearest_neighbour_route(problem.graph, problem.instance)),
+	params(default_parameters(problem, initial_route)) {}
+
+LoadedProblem::LoadedProblem(const std::filesystem::path& path, int neighbours)
+	: LoadedProblem(Problem(path.string(), neighbours)) {}
+
+void SlotPool::acquire(int count) {
+	std::unique_lock<std::mutex> lock(mutex);
+	const uint64_t ticket = next_ticket++;
+	freed.wait(lock, [&]() { return ticket == serving && free >= count; });
+	free -= count;
+	serving++;
+	freed.notify_all();
+}
+
+void SlotPool::release(int count) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		free += count;
+	}
+	freed.notify_all();
+}
+
+int colony_threads(const std::string& colony, const LoadedProblem& loaded, int pool, std::string& spec) {
+	const auto sep = colony.find(':');
+	const std::string name = colony.substr(0, sep);
+	const std::string args = sep != std::string::npos ? colony.substr(sep + 1) : "";
+	const int ants = loaded.ants.size();
+	const int sized = std::clamp(static_cast<int>(loaded.problem.graph.node_count()) / batch_nodes_per_thread, 1, pool);
+
+	// Counts beyond the pool are cut down in the spec, a colony never starts more threads than it was charged for
+	spec = colony;
+	if (name == "threaded") {
+		const int threads = std::min(is_auto(args) || args.empty() ? sized : positive_count(args), pool);
+		spec = name + ":" + std::to_string(threads);
+		return std::min(threads, ants);
+	}
+	if (name == "acs") {
+		const auto comma = args.find(',');
+		const std::string threads_arg = args.substr(0, comma);
+		const int threads = std::min(is_auto(threads_arg) ? sized : threads_arg.empty() ? 1 : positive_count(threads_arg), pool);
+		spec = name + ":" + std::to_string(threads) + (comma != std::string::npos ? args.substr(comma) : "");
+		return std::min(threads, ants);
+	}
+	if (name == "batched") {
+		// One thread per batch, batches grow if there would be more of them than slots
+		int batch = positive_count(args);
+		if ((ants + batch - 1) / batch > pool) {
+			batch = (ants + pool - 1) / pool;
+			spec = name + ":" + std::to_string(batch);
+		}
+		return (ants + batch - 1) / batch;
+	}
+	return 1;
+}
+
+std::vector<std::filesystem::path> batch_problems(const std::vector<std::filesystem::path>& sources) {
+	std::vector<std::filesystem::path> problems;
+
+	for (const auto& source : sources) {
+		if (std::filesystem::is_directory(source)) {
+			std::vector<std::filesystem::path> found;
+			for (const auto& entry : std::filesystem::directory_iterator(source)) {
+				if (entry.is_regular_file() && entry.path().extension() == ".sop") {
+					found.push_back(entry.path());
+				}
+			}
+			std::sort(found.begin(), found.end());
+			problems.insert(problems.end(), found.begin(), found.end());
+			continue;
+		}
+
+		if (source.extension() == ".txt") {
+			std::ifstream manifest(source);
+			if (!manifest.is_open()) {
+				std::cout << "Could not open manifest '" << source.string() << "'" << std::endl;
+				exit(1);
+			}
+
+			std::string line;
+			while (std::getline(manifest, line)) {
+				line = line.substr(0, line.find('#'));
+				const auto first = line.find_first_not_of(" \t\r");
+				if (first == std::string::npos) { continue; }
+				const std::filesystem::path path = line.substr(first, line.find_last_not_of(" \t\r") - first + 1);
+				problems.push_back(path.is_absolute() ? path : source.parent_path() / path);
+			}
+			continue;
+		}
+
+		problems.push_back(source);
+	}
+
+	return problems;
+}
+
+std::vector<BatchResult> run_batch(const BenchConfig& config, int threads, int neighbours) {
+	if (make_update_strategy(config.update) == nullptr) {
+		std::cout << "Invalid update strategy: " << config.update << std::endl;
+		exit(1);
+	}
+	// makeColony exits on unknown colonies, find them before anything runs
+	for (const auto& colony : config.colonies) {
+		const std::string name = colony.substr(0, colony.find(':'));
+		if (std::none_of(colonies.begin(), colonies.end(), [&](const std::unique_ptr<AbstractColonyFactory>& e) { return e->name() == name; })) {
+			std::cout << "Unknown colony: " << name << std::endl;
+			exit(1);
+		}
+	}
+
+	std::vector<std::unique_ptr<ProblemEntry>> problems;
+	for (const auto& path : config.problems) {
+		if (!std::filesystem::is_regular_file(path)) {
+			std::cout << "Skipping '" << path.string() << "': not a file" << std::endl;
+			continue;
+		}
+		problems.push_back(std::make_unique<ProblemEntry>());
+		problems.back()->path = path;
+		problems.back()->file_size = std::filesystem::file_size(path);
+	}
+
+	// Largest first, small problems fill the gaps at the end. File size stands in for the problem size.
+	std::stable_sort(problems.begin(), problems.end(), [](const auto& a, const auto& b) { return a->file_size > b->file_size; });
+
+	std::vector<Job> jobs;
+	for (const auto& problem : problems) {
+		for (const auto& colony : config.colonies) {
+			for (unsigned int seed : config.seeds) {
+				for (int rounds : config.rounds) {
+					jobs.push_back(Job{ problem.get(), colony, seed, rounds });
+					problem->remaining++;
+				}
+			}
+		}
+	}
+
+	std::vector<BatchResult> results(jobs.size());
+	SlotPool slots(threads);
+	std::mutex queue_mutex, print_mutex;
+	size_t next_job = 0;
+
+	auto worker = [&]() {
+		while (true) {
+			size_t index;
+			{
+				std::lock_guard<std::mutex> lock(queue_mutex);
+				if (next_job == jobs.size()) { return; }
+				index = next_job++;
+			}
+			const Job& job = jobs[index];
+			ProblemEntry& entry = *job.problem;
+
+			// Later jobs of the problem wait here while the first one loads it
+			LoadedProblem* loaded;
+			{
+				std::lock_guard<std::mutex> lock(entry.mutex);
+				if (entry.loaded == nullptr) {
+					entry.loaded = std::make_unique<LoadedProblem>(entry.path, neighbours);
+				}
+				loaded = entry.loaded.get();
+			}
+
+			BatchResult& result = results[index];
+			result.problem = entry.path.stem().string();
+			result.seed = job.seed;
+			result.rounds = job.rounds;
+			result.nodes = loaded->problem.graph.node_count();
+			result.bounds = loaded->problem.bounds;
+			try {
+				result.threads = colony_threads(job.colony, *loaded, threads, result.colony);
+			}
+			catch (const std::exception&) {
+				std::cout << "Invalid colony: " << job.colony << std::endl;
+				exit(1);
+			}
+
+			slots.acquire(result.threads);
+			{
+				const auto start = std::chrono::steady_clock::now();
+
+				std::unique_ptr<AntOptimizer> colony = makeColony(result.colony, loaded->problem, loaded->ants, loaded->params);
+				colony->update_best_route(loaded->initial_route);
+				colony->set_update_strategy(make_update_strategy(config.update));
+				colony->seed(job.seed);
+				Profiler pf = colony->optimize(job.rounds);
+
+				result.total = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+				result.round_mean = std::chrono::duration<double, std::micro>(pf.avg()).count();
+				result.best_length = colony->best_route.length;
+			}
+			slots.release(result.threads);
+
+			const int known = result.bounds.second;
+			result.gap = known > 0 && result.best_length >= 0 ? static_cast<double>(result.best_length - known) / known : -1;
+
+			{
+				std::lock_guard<std::mutex> lock(entry.mutex);
+				if (--entry.remaining == 0) {
+					entry.loaded.reset();
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(print_mutex);
+				print_result(result);
+			}
+		}
+	};
+
+	// A job takes at least one slot, more workers could never run
+	std::vector<std::thread> workers;
+	for (int i = 0; i < std::min<size_t>(threads, jobs.size()); i++) {
+		workers.emplace_back(worker);
+	}
+	for (auto& w : workers) {
+		w.join();
+	}
+
+	return results;
+}
+
+void write_batch_json(const std::filesystem::path& path, const BenchConfig& config, int threads, const std::vector<BatchResult>& results) {
+	std::ofstream file(path);
+	file
+		<< "{\n"
+		<< "  \"timestamp\": " << json_string(print_now()) << ",\n"
+		<< "  \"update\": " << json_string(config.update) << ",\n"
+		<< "  \"threads\": " << threads << ",\n"
+		<< "  \"results\": [";
+
+	bool first = true;
+	for (const auto& r : results) {
+		file << (first ? "\n" : ",\n");
+		first = false;
+
+		file
+			<< "    {"
+			<< "\"problem\": " << json_string(r.problem) << ", "
+			<< "\"colony\": " << json_string(r.colony) << ", "
+			<< "\"seed\": " << r.seed << ", "
+			<< "\"rounds\": " << r.rounds << ", "
+			<< "\"nodes\": " << r.nodes << ", "
+			<< "\"threads\": " << r.threads << ", "
+			<< "\"bounds\": [" << r.bounds.first << ", " << r.bounds.second << "], "
+			<< "\"best_length\": " << r.best_length << ", "
+			<< "\"gap\": " << r.gap << ", "
+			<< "\"round_mean_us\": " << r.round_mean << ", "
+			<< "\"total_ms\": " << r.total << "}";
+	}
+
+	file << "\n  ]\n}\n";
+}
+
+void write_batch_csv(const std::filesystem::path& path, const std::vector<BatchResult>& results) {
+	std::ofstream file(path);
+	file << "problem;colony;seed;rounds;nodes;threads;best_length;gap;bounds_min;bounds_max;round_mean_µs;total_ms;" << "\n";
+
+	for (const auto& r : results) {
+		file
+			<< r.problem << ";"
+			<< r.colony << ";"
+			<< r.seed << ";"
+			<< r.rounds << ";"
+			<< r.nodes << ";"
+			<< r.threads << ";"
+			<< r.best_length << ";"
+			<< r.gap << ";"
+			<< r.bounds.first << ";" << r.bounds.second << ";"
+			<< r.round_mean << ";"
+			<< r.total << ";"
+			<< "\n";
+	}
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "bench.hpp"
+#include "problem.hpp"
+#include "colonies/base.hpp"
+
+/*
+	Everything the jobs of one problem share
+*/
+struct LoadedProblem {
+	Problem problem;
+	std::vector<Ant> ants;
+	Route initial_route;
+	Parameters params;
+
+	explicit LoadedProblem(Problem problem);
+	LoadedProblem(const std::filesystem::path& path, int neighbours);
+};
+
+/*
+	Counts free thread slots, it only limits how many threads the running colonies start and runs nothing itself.
+	Slots are handed out in the order they were asked for, so a job waiting for many slots is not overtaken
+	by a stream of single threaded jobs.
+*/
+class SlotPool {
+private:
+	std::mutex mutex;
+	std::condition_variable freed;
+	int free;
+	uint64_t next_ticket = 0;
+	uint64_t serving = 0;
+public:
+	explicit SlotPool(int slots) : free(slots) {}
+
+	void acquire(int count);
+	void release(int count);
+};
+
+/*
+	Result of one (problem, colony, seed, rounds) job of a batch
+*/
+struct BatchResult {
+	std::string problem;
+	// Colony spec as run, `auto` replaced by the thread count
+	std::string colony;
+	unsigned int seed;
+	int rounds;
+	int nodes;
+	// Slots of the pool the job occupied
+	int threads;
+	std::pair<int, int> bounds;
+
+	int best_length;
+	// Gap of `best_length` to the best known solution, -1 if unknown
+	double gap;
+	// Average time per round in µs and wall time of the job including building the colony in ms
+	double round_mean;
+	double total;
+};
+
+/*
+	Problem files of every source: directories give their .sop files (sorted by name),
+	.txt files are manifests with one path per line (relative to the manifest, # starts a comment)
+	and everything else is taken as a problem file
+*/
+std::vector<std::filesystem::path> batch_problems(const std::vector<std::filesystem::path>& sources);
+
+/*
+	Threads `colony` runs for `loaded` on a pool of `pool` slots (1 to `pool`), and the spec to build it from:
+	`auto` replaced by the count, thread counts above `pool` lowered to it, batches grown until they fit.
+	Throws std::invalid_argument if a thread count or batch size is no number or below 1.
+*/
+int colony_threads(const std::string& colony, const LoadedProblem& loaded, int pool, std::string& spec);
+
+/*
+	Runs every problem with every colony, seed and round count of `config`, as many at once as fit into `threads` slots.
+	A job occupies as many slots as its colony starts threads, `auto` in a colony spec
+	(`threaded:auto`, `acs:auto,0.9`) gets one thread per `batch_nodes_per_thread` nodes.
+	Large problems are started first, small ones fill the remaining slots.
+	Every problem is loaded once by its first job and released after its last.
+*/
+constexpr int batch_nodes_per_thread = 100;
+std::vector<BatchResult> run_batch(const BenchConfig& config, int threads, int neighbours);
+
+void write_batch_json(const std::filesystem::path& path, const BenchConfig& config, int threads, const std::vector<BatchResult>& results);
+void write_batch_csv(const std::filesystem::path& path, const std::vector<BatchResult>& results);
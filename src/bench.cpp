@@ -0,0 +1,623 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "bench.hpp"
+#include "heuristic.hpp"
+#include "problem.hpp"
+#include "report.hpp"
+#include "colonies/registry.hpp"
+
+namespace {
+	double micros(Profiler::Duration d) {
+		return std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(d).count();
+	}
+
+	// Nearest rank percentile of sorted `values`
+	double percentile(const std::vector<double>& values, double p) {
+		if (values.empty()) { return 0; }
+		size_t rank = static_cast<size_t>(std::ceil(p * values.size()));
+		return values.at(std::clamp<size_t>(rank, 1, values.size()) - 1);
+	}
+
+	std::string json_string(const std::string& str) {
+		std::string result = "\"";
+		for (char c : str) {
+			if (c == '"' || c == '\\') { result += '\\'; }
+			result += c;
+		}
+		return result + "\"";
+	}
+
+	/*
+		Best known solution of `problem`, -1 if unknown
+	*/
+	int best_known(const std::pair<int, int>& bounds) {
+		return bounds.second;
+	}
+
+	BenchResult run_cell(const Problem& problem, const std::string& problem_name, const Route& initial_route, const std::vector<Ant>& ants, Parameters params, std::shared_ptr<UpdateStrategy> update, const std::string& colony_spec, unsigned int seed, int rounds, const BenchConfig& config) {
+		BenchResult result;
+		result.problem = problem_name;
+		result.colony = colony_spec;
+		result.seed = seed;
+		result.rounds = rounds;
+		result.trials = config.trials;
+		result.bounds = problem.bounds;
+		result.best_length = std::numeric_limits<int>::max();
+		result.reached = 0;
+
+		int known = best_known(problem.bounds);
+		result.target = known >= 0 ? static_cast<int>(std::floor(known * (1 + config.target_gap))) : -1;
+
+		// Round times of all measured trials
+		Histogram samples;
+		std::vector<double> times_to_target;
+
+		for (int run = 0; run < config.warmup + config.trials; run++) {
+			std::unique_ptr<AntOptimizer> colony = makeColony(colony_spec, problem, ants, params);
+			colony->update_best_route(initial_route);
+			colony->set_update_strategy(update);
+			colony->seed(seed);
+
+			std::unique_ptr<ConvergenceWriter> convergence;
+			if (!config.convergence.empty() && run >= config.warmup) {
+				convergence = std::make_unique<ConvergenceWriter>(config.convergence, problem_name + ":" + colony_spec + ":" + std::to_string(seed));
+				colony->convergence = convergence.get();
+				colony->convergence_every = config.convergence_every;
+			}
+
+			Profiler pf = colony->optimize(rounds);
+			if (run < config.warmup) { continue; }
+
+			samples += pf.durations;
+			result.trial_means.push_back(micros(pf.avg()));
+
+			if (result.target >= 0) {
+				auto ttt = pf.time_to_target(result.target);
+				if (ttt.count() >= 0) {
+					times_to_target.push_back(micros(ttt));
+					result.reached++;
+				}
+			}
+
+			if (colony->best_route.length >= 0) {
+				result.best_length = std::min(result.best_length, colony->best_route.length);
+			}
+		}
+
+		std::sort(times_to_target.begin(), times_to_target.end());
+		result.median = micros(Profiler::Duration(samples.percentile(0.5)));
+		result.p10 = micros(Profiler::Duration(samples.percentile(0.1)));
+		result.p90 = micros(Profiler::Duration(samples.percentile(0.9)));
+		result.min = micros(Profiler::Duration(samples.min()));
+		result.max = micros(Profiler::Duration(samples.max()));
+		result.round_times = samples;
+		result.time_to_target = times_to_target.empty() ? -1 : percentile(times_to_target, 0.5);
+		result.gap = known > 0 && result.best_length != std::numeric_limits<int>::max()
+			? static_cast<double>(result.best_length - known) / known
+			: -1;
+
+		return result;
+	}
+
+	void print_result(const BenchResult& result) {
+		std::cout.precision(4);
+		std::cout
+			<< "[" << result.problem << "] "
+			<< result.colony << " seed=" << result.seed << " rounds=" << result.rounds << " : "
+			<< result.median / 1000 << "ms median ("
+			<< result.p10 / 1000 << " - " << result.p90 / 1000 << "ms p10-p90), best "
+			<< result.best_length;
+		if (result.gap >= 0) {
+			std::cout << " (gap " << result.gap * 100 << "%)";
+		}
+		std::cout << std::endl;
+	}
+
+	/*
+		One sided Mann-Whitney U test with the normal approximation.
+		Returns the p-value of `current` not being stochastically larger (slower) than `baseline`.
+		Values in the same histogram bucket count as ties.
+	*/
+	double mann_whitney_slower(const Histogram& baseline, const Histogram& current) {
+		const double n1 = baseline.count(), n2 = current.count(), n = n1 + n2;
+		if (n1 == 0 || n2 == 0) { return 1; }
+
+		// Both histograms share the bucket layout, so equal midpoints are equal buckets
+		std::map<uint64_t, std::pair<uint64_t, uint64_t>> buckets;
+		baseline.for_each([&](uint64_t value, uint64_t count) { buckets[value].first += count; });
+		current.for_each([&](uint64_t value, uint64_t count) { buckets[value].second += count; });
+
+		double seen = 0, rank_sum = 0, ties = 0;
+		for (const auto& bucket : buckets) {
+			const double t = bucket.second.first + bucket.second.second;
+			rank_sum += bucket.second.second * (seen + (t + 1) / 2);
+			ties += t * t * t - t;
+			seen += t;
+		}
+
+		const double u = rank_sum - n2 * (n2 + 1) / 2;
+		const double mean = n1 * n2 / 2;
+		const double variance = n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1)));
+		if (variance <= 0) { return 1; }
+
+		const double z = (u - mean - 0.5) / std::sqrt(variance);
+		return 0.5 * std::erfc(z / std::sqrt(2.0));
+	}
+
+	std::vector<std::string> split(const std::string& line, char separator) {
+		std::vector<std::string> fields;
+		std::stringstream stream(line);
+		std::string field;
+		while (std::getline(stream, field, separator)) {
+			fields.push_back(field);
+		}
+		return fields;
+	}
+}
+
+std::vector<BenchResult> run_bench(const BenchConfig& config) {
+	std::vector<BenchResult> results;
+
+	std::shared_ptr<UpdateStrategy> update = make_update_strategy(config.update);
+	if (update == nullptr) {
+		std::cout << "Invalid update strategy: " << config.update << std::endl;
+		exit(1);
+	}
+
+	for (const auto& path : config.problems) {
+		if (!std::filesystem::is_regular_file(path)) {
+			std::cout << "Skipping '" << path.string() << "': not a file" << std::endl;
+			continue;
+		}
+
+		Problem problem(path);
+		std::vector<Ant> ants(default_ant_count(problem), Ant(0));
+		Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+		Parameters params = default_parameters(problem, initial_route);
+
+		for (const auto& colony_spec : config.colonies) {
+			for (unsigned int seed : config.seeds) {
+				for (int rounds : config.rounds) {
+					BenchResult result = run_cell(problem, path.stem().string(), initial_route, ants, params, update, colony_spec, seed, rounds, config);
+					print_result(result);
+					results.push_back(result);
+				}
+			}
+		}
+	}
+
+	return results;
+}
+
+std::vector<BenchResult> read_bench_csv(const std::filesystem::path& path) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cout << "Could not open baseline '" << path.string() << "'" << std::endl;
+		exit(1);
+	}
+
+	std::string line;
+	std::getline(file, line);
+	std::map<std::string, size_t> columns;
+	const auto header = split(line, ';');
+	for (size_t i = 0; i < header.size(); i++) {
+		columns[header[i]] = i;
+	}
+
+	for (const char* required : { "problem", "colony", "seed", "rounds", "trials", "median_µs" }) {
+		if (columns.count(required) == 0) {
+			std::cout << "Baseline '" << path.string() << "' has no column " << required << std::endl;
+			exit(1);
+		}
+	}
+
+	std::vector<BenchResult> results;
+	while (std::getline(file, line)) {
+		if (line.empty()) { continue; }
+		const auto fields = split(line, ';');
+		auto field = [&](const char* name) -> std::string {
+			auto column = columns.find(name);
+			return column != columns.end() && column->second < fields.size() ? fields[column->second] : "";
+		};
+		auto number = [&](const char* name) {
+			std::string value = field(name);
+			return value.empty() ? 0.0 : std::stod(value);
+		};
+
+		BenchResult r;
+		r.problem = field("problem");
+		r.colony = field("colony");
+		r.seed = static_cast<unsigned int>(number("seed"));
+		r.rounds = static_cast<int>(number("rounds"));
+		r.trials = static_cast<int>(number("trials"));
+		r.bounds = { static_cast<int>(number("bounds_min")), static_cast<int>(number("bounds_max")) };
+		r.median = number("median_µs");
+		r.p10 = number("p10_µs");
+		r.p90 = number("p90_µs");
+		r.min = number("min_µs");
+		r.max = number("max_µs");
+		r.target = static_cast<int>(number("target"));
+		r.time_to_target = number("time_to_target_µs");
+		r.reached = static_cast<int>(number("reached"));
+		r.best_length = static_cast<int>(number("best_length"));
+		r.gap = number("gap");
+
+		// value:count pairs in ns
+		for (const auto& bucket : split(field("round_histogram"), ',')) {
+			auto sep = bucket.find(':');
+			if (sep == std::string::npos) { continue; }
+			r.round_times.record(std::stoull(bucket.substr(0, sep)), std::stoull(bucket.substr(sep + 1)));
+		}
+
+		results.push_back(r);
+	}
+
+	return results;
+}
+
+std::vector<BenchComparison> compare_bench(const BenchConfig& config, const std::vector<BenchResult>& baseline, const std::filesystem::path& baseline_path, float threshold, float alpha, std::vector<BenchResult>& results) {
+	std::vector<BenchComparison> comparisons;
+
+	std::shared_ptr<UpdateStrategy> update = make_update_strategy(config.update);
+	if (update == nullptr) {
+		std::cout << "Invalid update strategy: " << config.update << std::endl;
+		exit(1);
+	}
+
+	std::vector<std::string> problem_names;
+	for (const auto& r : baseline) {
+		if (std::find(problem_names.begin(), problem_names.end(), r.problem) == problem_names.end()) {
+			problem_names.push_back(r.problem);
+		}
+	}
+
+	for (const auto& name : problem_names) {
+		// Baselines default to <problem_folder>/profiler/bench_<timestamp>.csv
+		std::filesystem::path path = baseline_path.parent_path().parent_path() / (name + ".sop");
+		for (const auto& given : config.problems) {
+			if (given.stem().string() == name) { path = given; }
+		}
+
+		if (!std::filesystem::is_regular_file(path)) {
+			std::cout << "Skipping '" << name << "': problem file not found, pass it as FILE" << std::endl;
+			continue;
+		}
+
+		Problem problem(path);
+		std::vector<Ant> ants(default_ant_count(problem), Ant(0));
+		Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+		Parameters params = default_parameters(problem, initial_route);
+
+		for (const auto& base : baseline) {
+			if (base.problem != name) { continue; }
+
+			BenchConfig cell_config = config;
+			cell_config.trials = base.trials;
+			BenchResult current = run_cell(problem, name, initial_route, ants, params, update, base.colony, base.seed, base.rounds, cell_config);
+			results.push_back(current);
+
+			BenchComparison c{ base, current, 0, -1, false };
+			c.slowdown = base.median > 0 ? current.median / base.median - 1 : 0;
+			if (base.round_times.count() > 0) {
+				c.p = mann_whitney_slower(base.round_times, current.round_times);
+				c.regression = c.slowdown > threshold && c.p < alpha;
+			}
+			else {
+				// Baseline without round times, only the threshold applies
+				c.regression = c.slowdown > threshold;
+			}
+			comparisons.push_back(c);
+
+			std::cout.precision(4);
+			std::cout
+				<< (c.regression ? "REGRESSION " : "ok         ")
+				<< "[" << name << "] " << base.colony << " seed=" << base.seed << " rounds=" << base.rounds << " : "
+				<< base.median / 1000 << "ms -> " << current.median / 1000 << "ms median ("
+				<< (c.slowdown >= 0 ? "+" : "") << c.slowdown * 100 << "%";
+			if (c.p >= 0) {
+				std::cout << ", p=" << c.p;
+			}
+			std::cout << ")" << std::endl;
+		}
+	}
+
+	return comparisons;
+}
+
+std::vector<ScalingResult> run_scaling(const BenchConfig& config, int max_threads) {
+	std::vector<ScalingResult> results;
+
+	std::shared_ptr<UpdateStrategy> update = make_update_strategy(config.update);
+	if (update == nullptr) {
+		std::cout << "Invalid update strategy: " << config.update << std::endl;
+		exit(1);
+	}
+
+	const int rounds = config.rounds.front();
+
+	for (const auto& path : config.problems) {
+		if (!std::filesystem::is_regular_file(path)) {
+			std::cout << "Skipping '" << path.string() << "': not a file" << std::endl;
+			continue;
+		}
+
+		Problem problem(path);
+		std::vector<Ant> ants(default_ant_count(problem), Ant(0));
+		Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+		Parameters params = default_parameters(problem, initial_route);
+		const int ant_count = ants.size();
+
+		// (colony, threads) pairs, the first of every family is its single threaded reference
+		std::vector<std::vector<std::pair<std::string, int>>> families(2);
+		for (int threads = 1; threads <= max_threads; threads++) {
+			families[0].emplace_back("threaded:" + std::to_string(threads), threads);
+		}
+		for (int batch = ant_count; ; batch = (batch + 1) / 2) {
+			families[1].emplace_back("batched:" + std::to_string(batch), (ant_count + batch - 1) / batch);
+			if (batch == 1) { break; }
+		}
+
+		for (const auto& family : families) {
+			double reference = 0;
+			for (const auto& configuration : family) {
+				Histogram round_times;
+				for (unsigned int seed : config.seeds) {
+					round_times += run_cell(problem, path.stem().string(), initial_route, ants, params, update, configuration.first, seed, rounds, config).round_times;
+				}
+
+				ScalingResult r{ path.stem().string(), configuration.first, configuration.second, micros(Profiler::Duration(round_times.percentile(0.5))), 1, 1, -1 };
+				if (reference == 0) { reference = r.median; }
+
+				const double p = r.threads;
+				r.speedup = r.median > 0 ? reference / r.median : 0;
+				r.efficiency = r.speedup / p;
+				if (p > 1 && r.speedup > 0) {
+					r.karp_flatt = (1 / r.speedup - 1 / p) / (1 - 1 / p);
+				}
+
+				std::cout.precision(4);
+				std::cout
+					<< "[" << r.problem << "] " << r.colony << " (" << r.threads << " threads) : "
+					<< r.median / 1000 << "ms median, speedup " << r.speedup
+					<< ", efficiency " << r.efficiency * 100 << "%";
+				if (r.karp_flatt >= 0) {
+					std::cout << ", serial fraction " << r.karp_flatt;
+				}
+				std::cout << std::endl;
+
+				results.push_back(r);
+			}
+		}
+	}
+
+	return results;
+}
+
+void write_scaling_csv(const std::filesystem::path& path, const std::vector<ScalingResult>& results) {
+	std::ofstream file(path);
+	file << "problem;colony;threads;median_µs;speedup;efficiency;karp_flatt;" << "\n";
+
+	for (const auto& r : results) {
+		file
+			<< r.problem << ";"
+			<< r.colony << ";"
+			<< r.threads << ";"
+			<< r.median << ";"
+			<< r.speedup << ";"
+			<< r.efficiency << ";"
+			<< r.karp_flatt << ";"
+			<< "\n";
+	}
+}
+
+int TttResult::reached() const {
+	return std::count_if(samples.begin(), samples.end(), [](const Sample& s) { return s.time >= 0; });
+}
+
+std::vector<TttResult> run_time_to_target(const BenchConfig& config) {
+	std::vector<TttResult> results;
+
+	std::shared_ptr<UpdateStrategy> update = make_update_strategy(config.update);
+	if (update == nullptr) {
+		std::cout << "Invalid update strategy: " << config.update << std::endl;
+		exit(1);
+	}
+
+	const std::vector<float> gaps = config.target_gaps.empty() ? std::vector<float>{ config.target_gap } : config.target_gaps;
+
+	for (const auto& path : config.problems) {
+		if (!std::filesystem::is_regular_file(path)) {
+			std::cout << "Skipping '" << path.string() << "': not a file" << std::endl;
+			continue;
+		}
+
+		Problem problem(path);
+		std::vector<Ant> ants(default_ant_count(problem), Ant(0));
+		Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+		Parameters params = default_parameters(problem, initial_route);
+		const int known = best_known(problem.bounds);
+		if (known < 0) {
+			std::cout << "Skipping '" << path.string() << "': no best known solution" << std::endl;
+			continue;
+		}
+
+		for (const auto& colony_spec : config.colonies) {
+			for (int rounds : config.rounds) {
+				const size_t first = results.size();
+				for (float gap : gaps) {
+					results.push_back(TttResult{ path.stem().string(), colony_spec, rounds, gap, static_cast<int>(std::floor(known * (1 + gap))), {} });
+				}
+
+				for (unsigned int seed : config.seeds) {
+					std::unique_ptr<AntOptimizer> colony = makeColony(colony_spec, problem, ants, params);
+					colony->update_best_route(initial_route);
+					colony->set_update_strategy(update);
+					colony->seed(seed);
+
+					std::unique_ptr<ConvergenceWriter> convergence;
+					if (!config.convergence.empty()) {
+						convergence = std::make_unique<ConvergenceWriter>(config.convergence, path.stem().string() + ":" + colony_spec + ":" + std::to_string(seed));
+						colony->convergence = convergence.get();
+						colony->convergence_every = config.convergence_every;
+					}
+
+					Profiler pf = colony->optimize(rounds);
+
+					for (size_t i = first; i < results.size(); i++) {
+						TttResult::Sample sample{ seed, -1, -1 };
+						for (const auto& improvement : pf.improvements) {
+							if (improvement.length <= results[i].target) {
+								sample.time = micros(improvement.elapsed);
+								sample.rounds = improvement.round;
+								break;
+							}
+						}
+						results[i].samples.push_back(sample);
+					}
+				}
+
+				for (size_t i = first; i < results.size(); i++) {
+					TttResult& r = results[i];
+					std::sort(r.samples.begin(), r.samples.end(), [](const TttResult::Sample& a, const TttResult::Sample& b) {
+						if ((a.time < 0) != (b.time < 0)) { return b.time < 0; }
+						return a.time < b.time;
+					});
+
+					std::vector<double> times;
+					for (const auto& s : r.samples) {
+						if (s.time >= 0) { times.push_back(s.time); }
+					}
+
+					std::cout.precision(4);
+					std::cout
+						<< "[" << r.problem << "] "
+						<< r.colony << " rounds=" << r.rounds << " target=" << r.target << " (gap " << r.gap * 100 << "%) : "
+						<< r.reached() << "/" << r.samples.size() << " reached";
+					if (!times.empty()) {
+						std::cout << ", " << percentile(times, 0.5) / 1000 << "ms median, " << percentile(times, 0.9) / 1000 << "ms p90";
+					}
+					std::cout << std::endl;
+				}
+			}
+		}
+	}
+
+	return results;
+}
+
+void write_ttt_csv(const std::filesystem::path& path, const std::vector<TttResult>& results) {
+	std::ofstream file(path);
+	file << "problem;colony;rounds;gap;target;seed;time_to_target_µs;rounds_to_target;probability;" << "\n";
+
+	for (const auto& r : results) {
+		// Empirical distribution as used for TTT plots: p_i = (i - 1/2) / n
+		for (size_t i = 0; i < r.samples.size(); i++) {
+			const auto& s = r.samples[i];
+			file
+				<< r.problem << ";"
+				<< r.colony << ";"
+				<< r.rounds << ";"
+				<< r.gap << ";"
+				<< r.target << ";"
+				<< s.seed << ";"
+				<< s.time << ";"
+				<< s.rounds << ";";
+			if (s.time >= 0) {
+				file << (i + 0.5) / r.samples.size();
+			}
+			file << ";" << "\n";
+		}
+	}
+}
+
+void write_bench_json(const std::filesystem::path& path, const BenchConfig& config, const std::vector<BenchResult>& results) {
+	std::ofstream file(path);
+	file
+		<< "{\n"
+		<< "  \"timestamp\": " << json_string(print_now()) << ",\n"
+		<< "  \"update\": " << json_string(config.update) << ",\n"
+		<< "  \"warmup\": " << config.warmup << ",\n"
+		<< "  \"trials\": " << config.trials << ",\n"
+		<< "  \"target_gap\": " << config.target_gap << ",\n"
+		<< "  \"results\": [";
+
+	bool first = true;
+	for (const auto& r : results) {
+		file << (first ? "\n" : ",\n");
+		first = false;
+
+		file
+			<< "    {"
+			<< "\"problem\": " << json_string(r.problem) << ", "
+			<< "\"colony\": " << json_string(r.colony) << ", "
+			<< "\"seed\": " << r.seed << ", "
+			<< "\"rounds\": " << r.rounds << ", "
+			<< "\"trials\": " << r.trials << ", "
+			<< "\"bounds\": [" << r.bounds.first << ", " << r.bounds.second << "], "
+			<< "\"round_us\": {"
+				<< "\"median\": " << r.median << ", "
+				<< "\"p10\": " << r.p10 << ", "
+				<< "\"p90\": " << r.p90 << ", "
+				<< "\"min\": " << r.min << ", "
+				<< "\"max\": " << r.max << "}, "
+			<< "\"trial_mean_us\": [";
+		for (size_t i = 0; i < r.trial_means.size(); i++) {
+			file << (i > 0 ? ", " : "") << r.trial_means[i];
+		}
+		file
+			<< "], "
+			<< "\"target\": " << r.target << ", "
+			<< "\"time_to_target_us\": " << r.time_to_target << ", "
+			<< "\"reached\": " << r.reached << ", "
+			<< "\"best_length\": " << r.best_length << ", "
+			<< "\"gap\": " << r.gap << ", "
+			<< "\"round_histogram_ns\": [";
+		bool first_bucket = true;
+		r.round_times.for_each([&](uint64_t value, uint64_t count) {
+			file << (first_bucket ? "" : ", ") << "[" << value << ", " << count << "]";
+			first_bucket = false;
+		});
+		file << "]}";
+	}
+
+	file << "\n  ]\n}\n";
+}
+
+void write_bench_csv(const std::filesystem::path& path, const std::vector<BenchResult>& results) {
+	std::ofstream file(path);
+	file << "problem;colony;seed;rounds;trials;median_µs;p10_µs;p90_µs;min_µs;max_µs;target;time_to_target_µs;reached;best_length;gap;bounds_min;bounds_max;round_histogram;" << "\n";
+
+	for (const auto& r : results) {
+		file
+			<< r.problem << ";"
+			<< r.colony << ";"
+			<< r.seed << ";"
+			<< r.rounds << ";"
+			<< r.trials << ";"
+			<< r.median << ";"
+			<< r.p10 << ";"
+			<< r.p90 << ";"
+			<< r.min << ";"
+			<< r.max << ";"
+			<< r.target << ";"
+			<< r.time_to_target << ";"
+			<< r.reached << ";"
+			<< r.best_length << ";"
+			<< r.gap << ";"
+			<< r.bounds.first << ";" << r.bounds.second << ";";
+
+		// value:count pairs of the round times in ns, see `read_bench_csv`
+		bool first_bucket = true;
+		r.round_times.for_each([&](uint64_t value, uint64_t count) {
+			file << (first_bucket ? "" : ",") << value << ":" << count;
+			first_bucket = false;
+		});
+		file << ";" << "\n";
+	}
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "colonies/histogram.hpp"
+
+/*
+	Benchmark matrix: every problem is solved by every colony
+	for every seed and round count.
+	Each cell runs `warmup` discarded runs followed by `trials` measured runs.
+*/
+struct BenchConfig {
+	std::vector<std::filesystem::path> problems;
+	std::vector<std::string> colonies;
+	std::vector<unsigned int> seeds;
+	std::vector<int> rounds;
+	std::string update = "iteration-best";
+	int warmup = 1;
+	int trials = 3;
+	// Target for time-to-target: best known solution + `target_gap`
+	float target_gap = 0.05;
+	// Targets of the time-to-target distributions, see `run_time_to_target`
+	std::vector<float> target_gaps;
+	// Results are written to <output>.json and <output>.csv
+	std::filesystem::path output;
+	// Appends the anytime curve of every run to this file if not empty
+	std::filesystem::path convergence;
+	int convergence_every = 0;
+};
+
+struct BenchResult {
+	std::string problem;
+	std::string colony;
+	unsigned int seed;
+	int rounds;
+	int trials;
+	std::pair<int, int> bounds;
+
+	// Time per round in µs over all rounds of all trials
+	double median, p10, p90, min, max;
+	// The same rounds in ns, stored in the results so later runs can be compared against them
+	Histogram round_times;
+	// Average time per round in µs, one entry per trial
+	std::vector<double> trial_means;
+
+	// Median time in µs until the target was reached, over the trials that reached it
+	double time_to_target;
+	int target;
+	int reached;
+
+	// Best final route over all trials and its gap to the best known solution
+	int best_length;
+	double gap;
+};
+
+/*
+	Time-to-target distribution of one colony over all seeds
+*/
+struct TttResult {
+	struct Sample {
+		unsigned int seed;
+		double time;  // µs until the target was reached, -1 if never
+		int rounds;   // Rounds until the target was reached, -1 if never
+	};
+
+	std::string problem;
+	std::string colony;
+	int rounds;
+	float gap;
+	int target;
+	// Sorted by time, runs that missed the target last
+	std::vector<Sample> samples;
+
+	int reached() const;
+};
+
+/*
+	One point of a thread scaling curve.
+	Times are medians over the rounds of all seeds and trials,
+	relative to the single threaded configuration of the same colony.
+*/
+struct ScalingResult {
+	std::string problem;
+	std::string colony;
+	int threads;
+	double median;     // µs per round
+	double speedup;    // T(1) / T(p)
+	double efficiency; // speedup / p
+	double karp_flatt; // Experimentally determined serial fraction (1/S - 1/p) / (1 - 1/p), -1 for p = 1
+};
+
+/*
+	One cell of the benchmark matrix rerun against a baseline
+*/
+struct BenchComparison {
+	BenchResult baseline;
+	BenchResult current;
+	// Relative change of the median round time, 0.1 = 10% slower
+	double slowdown;
+	// One sided Mann-Whitney U test on the round times: p-value of "current is not slower"
+	double p;
+	bool regression;
+};
+
+std::vector<BenchResult> run_bench(const BenchConfig& config);
+
+/*
+	Reads results written by `write_bench_csv`
+*/
+std::vector<BenchResult> read_bench_csv(const std::filesystem::path& path);
+
+/*
+	Reruns every cell of `baseline` (problems are looked up in `config.problems` by name, then next to the baseline's folder).
+	A cell regressed if its median is more than `threshold` slower and the test is significant at `alpha`.
+	`results` receives the new results.
+*/
+std::vector<BenchComparison> compare_bench(const BenchConfig& config, const std::vector<BenchResult>& baseline, const std::filesystem::path& baseline_path, float threshold, float alpha, std::vector<BenchResult>& results);
+
+/*
+	Runs threaded:1 .. threaded:<max_threads> and batched colonies with batch sizes
+	ants, ants / 2, ants / 4, .. 1 (one thread per batch) on every problem,
+	each with all `config.seeds` and the first round count
+*/
+std::vector<ScalingResult> run_scaling(const BenchConfig& config, int max_threads);
+void write_scaling_csv(const std::filesystem::path& path, const std::vector<ScalingResult>& results);
+
+/*
+	Runs every problem / colony / round count once per seed and collects
+	when each run first reached best known * (1 + gap) for every gap in `target_gaps`
+*/
+std::vector<TttResult> run_time_to_target(const BenchConfig& config);
+void write_ttt_csv(const std::filesystem::path& path, const std::vector<TttResult>& results);
+
+void write_bench_json(const std::filesystem::path& path, const BenchConfig& config, const std::vector<BenchResult>& results);
+void write_bench_csv(const std::filesystem::path& path, const std::vector<BenchResult>& results);
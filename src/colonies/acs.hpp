@@ -0,0 +1,382 @@
+#pragma once
+#include <pthread.h>
+#include <iostream>
+#include <system_error>
+
+#include <atomic>
+#include <thread>
+
+#include "base.hpp"
+#include "../semaphore.hpp"
+
+/*
+	Ant Colony System as described in [1]
+
+	- Pseudo-random proportional rule: With probability q0 an ant takes the
+	  best edge (argmax of tau * eta^beta), otherwise it falls back to the roulette wheel
+	- Local update: Every traversed edge decays towards tau0 while the ants are walking
+	  tau = (1 - xi) * tau + xi * tau0
+	- Global update: Only the best route so far evaporates and deposits
+	  tau = (1 - roh) * tau + roh / L_best
+
+	Arguments: acs[:<threads>[,<q0>]]
+		threads : Number of worker threads (or auto). Default: 1, ants walk on the calling thread
+		q0      : Probability of the greedy choice. Default: 0.9
+*/
+class AcsAntOptimizer: public AntOptimizer {
+private:
+	// Upper bounds of the roulette ranges and their nodes
+	typedef std::vector<std::pair<float, graph::Node>> Wheel;
+
+	struct ThreadArgs {
+		Ant* start_ant;
+		int ant_count;
+		AcsAntOptimizer& optimizer;
+		bool cancelled = false;
+		Wheel wheel = {};
+		PhaseTimes phases = {};
+		CounterValues counters = {};
+	};
+
+	static void* optimize_threaded(void* __args) {
+		ThreadArgs* args = static_cast<ThreadArgs*>(__args);
+		PerfCounters counters(args->optimizer.perf_counters);
+
+		while (true) {
+			{
+				ScopedPhase phase(args->phases, Phase::barrier);
+				args->optimizer.start_line.inc_and_wait(0);
+			}
+			if (args->cancelled) {
+				args->counters = counters.read();
+				return nullptr;
+			}
+
+			args->optimizer.walk_ants(args->start_ant, args->ant_count, args->phases, args->wheel);
+
+			ScopedPhase phase(args->phases, Phase::barrier);
+			args->optimizer.finish_line.inc_and_wait(0);
+		}
+	}
+
+	Semaphore start_line = Semaphore(0);
+	Semaphore finish_line = Semaphore(0);
+
+	std::vector<pthread_t> threads;
+	std::vector<ThreadArgs> thread_args;
+	std::vector<Ant> ants;
+	// Scratch of the calling thread when the ants walk there
+	Wheel wheel;
+	size_t num_threads = 1;
+
+	float q0 = 0.9;
+	float xi = 0.1;
+	float tau0 = 0;
+
+	/*
+		Pheromone trails are written by all walking ants concurrently.
+		Indexed by `edge_id` like `edge_pheromone`.
+	*/
+	std::vector<std::atomic<float>> trail;
+
+	void local_update(size_t edge) {
+		std::atomic<float>& tau = trail[edge];
+		float expected = tau.load(std::memory_order_relaxed);
+		while (!tau.compare_exchange_weak(expected, (1 - xi) * expected + xi * tau0, std::memory_order_relaxed)) {}
+	}
+
+	/*
+		`wheel` is scratch space of the calling thread, it only gets filled when the ant explores.
+		Exploiting needs nothing but the argmax, so q0 is drawn before the edges are scanned.
+	*/
+	void advance_acs_ant(Ant& ant, Wheel& wheel) {
+		std::uniform_real_distribution<float> distribution(0.0, 1.0);
+		graph::Node next = graph::NO_NODE;
+
+		if (distribution(ant.generator) < q0) {
+			float best_value = -1;
+			for_each_edge(ant.current_node, [&](graph::Node node, size_t edge) {
+				if (ant.allowed_nodes.at(node) != 0) { return; }
+
+				float value = trail[edge].load(std::memory_order_relaxed) * edge_visibility[edge];
+				if (value > best_value) {
+					best_value = value;
+					next = node;
+				}
+			});
+		}
+		else {
+			wheel.clear();
+			float sum = 0;
+			for_each_edge(ant.current_node, [&](graph::Node node, size_t edge) {
+				if (ant.allowed_nodes.at(node) != 0) { return; }
+
+				sum += trail[edge].load(std::memory_order_relaxed) * edge_visibility[edge];
+				wheel.emplace_back(sum, node);
+			});
+
+			float rand = distribution(ant.generator) * sum;
+			for (const auto& pair : wheel) {
+				if (rand < pair.first) {
+					next = pair.second;
+					break;
+				}
+			}
+		}
+
+		if (next == graph::NO_NODE && instance.candidate_lists()) {
+			next = fallback_node(ant);
+		}
+
+		const size_t edge = next >= 0 ? edge_id(ant.current_node, next) : NO_EDGE_ID;
+		if (edge != NO_EDGE_ID) {
+			local_update(edge);
+		}
+
+		ant.current_node = next;
+		ant.route.nodes.push_back(next);
+
+		if (next < 0) { return; }
+		visit_node(ant, next);
+	}
+
+	void walk_ants(Ant* start_ant, int ant_count, PhaseTimes& phases, Wheel& wheel) {
+		const Ant* end_ant = start_ant + ant_count;
+		for (Ant* ant = start_ant; ant != end_ant; ant++) {
+			if (cancelled()) { break; }
+
+			{
+				ScopedPhase phase(phases, Phase::construction);
+				for (int i = 0; i < graph.node_count() - 1; i++) {
+					advance_acs_ant(*ant, wheel);
+					if (ant->current_node == graph::NO_NODE) { break; }
+				}
+			}
+
+			if (!goal_reached(*ant)) { continue; }
+
+			ScopedPhase phase(phases, Phase::evaluation);
+			ant->route.length = route_length(ant->route.nodes);
+		}
+	}
+
+	void init_trails() {
+		// tau0 = 1 / (n * L_nn) if the colony was seeded with a route
+		tau0 = best_route.length > 0 && best_route.length != std::numeric_limits<int>::max()
+			? 1.0f / (graph.node_count() * best_route.length)
+			: params.initial_pheromone;
+
+		trail = std::vector<std::atomic<float>>(edge_pheromone.size());
+		for_all_edges([&](graph::Node, graph::Node, size_t edge) {
+			trail[edge].store(tau0, std::memory_order_relaxed);
+		});
+	}
+
+	/*
+		Without Max-Min bounds the tour's edges move towards q / L,
+		where the global update keeps the edges of a best route that never changes
+	*/
+	void warm_start(const Route& route, float strength) override {
+		update_best_route(route);
+		strength = std::clamp(strength, 0.0f, 1.0f);
+		if (route.length <= 0 || strength == 0) { return; }
+
+		init_trails();
+		const float target = params.q / route.length;
+		for (size_t i = 1; i < route.nodes.size(); i++) {
+			const size_t edge = edge_id(route.nodes[i - 1], route.nodes[i]);
+			if (edge == NO_EDGE_ID) { continue; }
+			trail[edge].store(tau0 + strength * (target - tau0), std::memory_order_relaxed);
+		}
+		publish_trails();
+	}
+
+	void publish_trails() {
+		for (size_t edge = 0; edge < trail.size(); edge++) {
+			edge_pheromone[edge] = trail[edge].load(std::memory_order_relaxed);
+		}
+	}
+
+	void save_state(BinaryWriter& out) const override {
+		std::vector<float> values(trail.size());
+		for (size_t edge = 0; edge < trail.size(); edge++) {
+			values[edge] = trail[edge].load(std::memory_order_relaxed);
+		}
+		out.put(tau0);
+		out.put(values);
+	}
+
+	bool load_state(BinaryReader& in) override {
+		std::vector<float> values;
+		if (!in.get(tau0) || !in.get(values)) { return false; }
+		// No trails yet if the checkpoint was taken before the first round
+		if (!values.empty() && values.size() != edge_pheromone.size()) { return false; }
+
+		trail = std::vector<std::atomic<float>>(values.size());
+		for (size_t edge = 0; edge < values.size(); edge++) {
+			trail[edge].store(values[edge], std::memory_order_relaxed);
+		}
+		return true;
+	}
+
+	// Lets the workers waiting at the start line return and joins them
+	void stop_workers() {
+		start_line.wait_and_lock(threads.size());
+
+			for (auto & args : thread_args) { args.cancelled = true; }
+			start_line.set(0);
+
+		start_line.unlock();
+
+		for (const auto & thread : threads) {
+			pthread_join(thread, nullptr);
+		}
+	}
+public:
+	using AntOptimizer::AntOptimizer;
+
+	static constexpr const char* _name = "acs";
+	std::string name() override { return _name; }
+
+	void memory_usage(MemoryReport& report) const override {
+		AntOptimizer::memory_usage(report);
+		report.add("ants", ants_bytes(ants));
+		report.add("trail", vector_bytes(trail));
+	}
+
+	void init(std::string args) override {
+		auto sep = args.find_first_of(",");
+		std::string threads_arg = args.substr(0, sep);
+
+		if (threads_arg == "cores" || threads_arg == "native" || threads_arg == "auto") {
+			num_threads = std::thread::hardware_concurrency();
+		}
+		else if (!threads_arg.empty()) {
+			num_threads = std::max(1, std::stoi(threads_arg));
+		}
+
+		if (sep != std::string::npos) {
+			q0 = std::stof(args.substr(sep + 1));
+		}
+	}
+
+	void optimize() override {
+		// Init Ants
+		{
+			ScopedPhase phase(phase_times, Phase::reset);
+			for (int i = 0; i < initial_ants.size(); i++) {
+				ants[i] = initial_ants[i];
+				ants[i].generator.seed(seed_generator());
+			}
+		}
+
+		if (threads.empty()) {
+			walk_ants(ants.data(), ants.size(), phase_times, wheel);
+		}
+		else {
+			ScopedPhase phase(phase_times, Phase::barrier);
+			start_line.wait_and_reset(threads.size());
+			finish_line.wait_and_reset(threads.size());
+		}
+
+		// Local updates of the dropped round stay, they only decay trails towards tau0
+		if (abandon_round()) { return; }
+
+		{
+			ScopedPhase phase(phase_times, Phase::reduction);
+			record_round(ants);
+			for (const Ant& ant : ants) {
+				if (ant.route.length == -1) { continue; }
+				update_best_route(ant);
+			}
+		}
+
+		if (best_route.nodes.empty()) { return; }
+
+		ScopedPhase phase(phase_times, Phase::update);
+
+		// Only the global best route deposits
+		const float deposit = params.roh * params.q / best_route.length;
+		for (auto it = std::next(best_route.nodes.begin()); it != best_route.nodes.end(); it++) {
+			const size_t edge = edge_id(*std::prev(it), *it);
+			if (edge == NO_EDGE_ID) { continue; }
+			std::atomic<float>& tau = trail[edge];
+			tau.store((1 - params.roh) * tau.load(std::memory_order_relaxed) + deposit, std::memory_order_relaxed);
+		}
+
+		round++;
+	}
+
+	Profiler optimize(int rounds) override {
+		Profiler pf;
+		phase_times.clear();
+		phase_times.trace = trace_thread("main");
+		PerfCounters counters(perf_counters);
+
+		if (trail.empty()) {
+			init_trails();
+		}
+
+		ants = initial_ants;
+		if (num_threads > 1) {
+			size_t first_ant = 0;
+
+			int cores = std::min(initial_ants.size(), num_threads);
+			int
+				ants_per_thread = initial_ants.size() / cores,
+				trailing_ants   = initial_ants.size() % cores;
+
+			for (int i = 0; i < cores; i++) {
+				int ant_count = ants_per_thread + (trailing_ants != 0 ? 1 : 0);
+				thread_args.emplace_back(ThreadArgs{
+					&ants.at(first_ant),
+					ant_count,
+					*this
+				});
+				first_ant += ant_count;
+				if (trailing_ants > 0) trailing_ants--;
+			}
+
+			for (auto & args : thread_args) {
+				args.phases.trace = trace_thread("worker " + std::to_string(threads.size()));
+				threads.emplace_back();
+				int succ = pthread_create(&threads.back(), nullptr, optimize_threaded, static_cast<void*>(&args));
+				if (succ != 0) {
+					// The workers started so far wait at the start line
+					threads.pop_back();
+					stop_workers();
+					threads.clear();
+					thread_args.clear();
+					throw std::system_error(succ, std::generic_category(), "pthread_create");
+				}
+			}
+		}
+
+		while (rounds-- > 0 && !stop_requested()) {
+			pf.start();
+			optimize();
+			if (round_abandoned) { break; }
+			finish_round(pf);
+		}
+
+		if (!threads.empty()) {
+			stop_workers();
+		}
+
+		pf.phases.push_back(phase_times);
+		for (const auto & args : thread_args) { pf.phases.push_back(args.phases); }
+		if (perf_counters) {
+			pf.counters.push_back(counters.read());
+			for (const auto & args : thread_args) { pf.counters.push_back(args.counters); }
+		}
+
+		if (!threads.empty()) {
+			threads.clear();
+			thread_args.clear();
+		}
+
+		publish_trails();
+
+		return pf;
+	}
+};
@@ -1,5 +1,7 @@
 #include <cmath>
 #include <chrono>
+#include <cstring>
+#include <sstream>
 
 #define DEBUG
 
@@ -7,13 +9,19 @@
 #include <iostream>
 #endif
 
+
 #include "base.hpp"
 
 float AntOptimizer::edge_value(const Ant& ant, graph::Node node) const {
+	const size_t edge = edge_id(ant.current_node, node);
+	return edge != NO_EDGE_ID ? edge_value(ant, node, edge) : 0;
+}
+
+float AntOptimizer::edge_value(const Ant& ant, graph::Node node, size_t edge) const {
 	if (ant.allowed_nodes.at(node) != 0) { return 0; }
 
-	float pher = edge_pheromone .at(graph::Edge(ant.current_node, node));
-	float vis  = edge_visibility.at(graph::Edge(ant.current_node, node));
+	float pher = std::max(params.min_pheromone, edge_pheromone[edge] * pheromone_scale);
+	float vis  = edge_visibility[edge];
 	return std::pow(pher, params.alpha) * vis;
 
 	// vis is precalculated in edge_visibility
@@ -38,24 +46,29 @@ void AntOptimizer::advance_ant(Ant& ant) const {
 		Used to easily select choice without normalizing first
 	*/
 	std::vector<std::pair<float, graph::Node>> choices;
-	choices.reserve(graph.node_count());
+	choices.reserve(out_degree(ant.current_node));
 
 	float sum = 0;
 	// ~90% of function is spent in this loop (without otimizations)
-	for (const graph::Node node : graph.adjacency_list.at(ant.current_node)) {
-		float value = edge_value(ant, node);
+	for_each_edge(ant.current_node, [&](graph::Node node, size_t edge) {
+		float value = edge_value(ant, node, edge);
 		sum += value;
 		choices.emplace_back(sum, node);
-	}
-	
-	std::uniform_real_distribution<float> distribution(0.0, sum);
-	float rand = distribution(ant.generator);
+	});
 	
 	graph::Node next = graph::NO_NODE;
-	for (const auto& pair : choices) {
-		if (rand < pair.first) {
-			next = pair.second;
-			break;
+	if (sum == 0 && instance.candidate_lists()) {
+		next = fallback_node(ant);
+	}
+	else {
+		std::uniform_real_distribution<float> distribution(0.0, sum);
+		float rand = distribution(ant.generator);
+
+		for (const auto& pair : choices) {
+			if (rand < pair.first) {
+				next = pair.second;
+				break;
+			}
 		}
 	}
 
@@ -79,52 +92,270 @@ void AntOptimizer::advance_ant(Ant& ant) const {
 		exception.
 	*/
 
+	visit_node(ant, next);
+}
+
+void AntOptimizer::visit_node(Ant& ant, graph::Node node) const {
 	// Mark this node as visited
-	ant.allowed_nodes.at(next) = -1;
+	ant.allowed_nodes.at(node) = -1;
 
 	// Update dependent nodes
-	for (const graph::Node node : sequence_graph.adjacency_list.at(next)) {
-		ant.allowed_nodes.at(node) -= 1;
+	for (auto it = instance.dependents_begin(node), end = instance.dependents_end(node); it != end; it++) {
+		ant.allowed_nodes[*it] -= 1;
 	}
 }
 
+graph::Node AntOptimizer::fallback_node(const Ant& ant) const {
+	graph::Node best = graph::NO_NODE;
+	int32_t best_weight = std::numeric_limits<int32_t>::max();
+	for (graph::Node node = 0; node < graph.node_count(); node++) {
+		if (ant.allowed_nodes[node] != 0) { continue; }
+
+		int32_t weight = instance.weight(ant.current_node, node);
+		if (weight != InstanceView::NO_EDGE && (best == graph::NO_NODE || weight < best_weight)) {
+			best = node;
+			best_weight = weight;
+		}
+	}
+	return best;
+}
+
 int AntOptimizer::route_length(const std::vector<graph::Node>& route) const {
 	int total = 0;
 	for (auto it1 = route.begin(), it2 = std::next(it1); it2 != route.end(); it1++, it2++) {
-		auto entry = edge_weight.find(graph::Edge(*it1, *it2));
-		if (entry == edge_weight.end()) { return std::numeric_limits<int>::max(); }
-		total += entry->second;
+		int weight = instance.weight(*it1, *it2);
+		if (weight == InstanceView::NO_EDGE) { return std::numeric_limits<int>::max(); }
+		total += weight;
 	}
 	return total;
 }
 
-float AntOptimizer::pheromone_update(const Ant& ant, graph::Edge edge) const {
-	float L_k = ant.route.length;
+float AntOptimizer::pheromone_update(const Route& route) const {
+	float L_k = route.length;
 	
 	return params.q / L_k;
 }
 
 std::pair<float, float> AntOptimizer::minmax_pheromone() const {
 	std::pair<float, float> minmax = std::make_pair(std::numeric_limits<float>::max(), std::numeric_limits<float>::min());
-	for (const auto& ph : edge_pheromone) {
-		minmax.first = std::min(minmax.first, ph.second);
-		minmax.second = std::max(minmax.second, ph.second);
-	}
+	for_all_edges([&](graph::Node, graph::Node, size_t edge) {
+		float value = std::max(params.min_pheromone, edge_pheromone[edge] * pheromone_scale);
+		minmax.first = std::min(minmax.first, value);
+		minmax.second = std::max(minmax.second, value);
+	});
 	return minmax;
 }
 
 bool AntOptimizer::update_best_route(const Ant& ant) {
-	if (ant.route.length < best_route.length) {
-		best_route = ant.route;
+	return update_best_route(ant.route);
+}
+
+bool AntOptimizer::update_best_route(const Route& route) {
+	if (route.length >= 0 && route.length < best_route.length) {
+		best_route = route;
 		return true;
 	}
 	return false;
 }
 
-void AntOptimizer::update_edge_pheromone(float& value, const float delta) {
-	value *= (1.0f - params.roh);
+void AntOptimizer::warm_start(const Route& route, float strength) {
+	update_best_route(route);
+	strength = std::clamp(strength, 0.0f, 1.0f);
+	if (route.length < 0 || strength == 0) { return; }
+
+	// Trails are still unscaled (pheromone_scale is 1) before the first round
+	for_all_edges([&](graph::Node, graph::Node, size_t edge) {
+		edge_pheromone[edge] += strength * (params.min_pheromone - edge_pheromone[edge]);
+	});
+	for (size_t i = 1; i < route.nodes.size(); i++) {
+		const size_t edge = edge_id(route.nodes[i - 1], route.nodes[i]);
+		if (edge == NO_EDGE_ID) { continue; }
+		edge_pheromone[edge] = params.initial_pheromone + strength * (params.max_pheromone - params.initial_pheromone);
+	}
+}
+
+void AntOptimizer::record_round(const std::vector<Ant>& ants) {
+	iteration_best = -1;
+	lost_ants = 0;
+	for (const Ant& ant : ants) {
+		if (ant.route.length == -1) {
+			lost_ants++;
+			continue;
+		}
+		if (iteration_best == -1 || ant.route.length < iteration_best) {
+			iteration_best = ant.route.length;
+		}
+	}
+}
+
+void AntOptimizer::finish_round(Profiler& pf) {
+	const size_t improvements = pf.improvements.size();
+	const Profiler::Duration before = pf.elapsed;
+	pf.stop(best_route.length);
+
+	rounds_done++;
+	elapsed_done += pf.elapsed - before;
+	if (checkpoint != nullptr && ((checkpoint_every > 0 && rounds_done % checkpoint_every == 0) || stop_requested())) {
+		checkpoint->submit(snapshot());
+	}
+
+	if (on_improvement && best_route.length >= 0 && (notified_length < 0 || best_route.length < notified_length)) {
+		notified_length = best_route.length;
+		on_improvement(*this);
+	}
+
+	if (convergence == nullptr) { return; }
+
+	// Counted over the colony's lifetime, a resumed run continues the trace of the checkpointed one
+	const int rounds = rounds_done;
+	const bool improved = pf.improvements.size() > improvements;
+	if (!improved && (convergence_every <= 0 || rounds % convergence_every != 0)) { return; }
+
+	convergence->push(ConvergencePoint{
+		rounds,
+		std::chrono::duration_cast<std::chrono::microseconds>(elapsed_done).count(),
+		iteration_best,
+		best_route.length,
+		lost_ants
+	});
+}
+
+TraceBuffer* AntOptimizer::trace_thread(const std::string& thread_name) {
+	if (trace == nullptr) { return nullptr; }
+	return trace->add_thread(name() + ":" + init_args, thread_name);
+}
+
+void AntOptimizer::evaporate_pheromone() {
+	if (pheromone_scale < min_pheromone_scale) {
+		// Fold scale back into the trails before it underflows
+		for (float& value : edge_pheromone) {
+			value = std::max(params.min_pheromone, value * pheromone_scale);
+		}
+		pheromone_scale = 1;
+	}
+
+	pheromone_scale *= (1.0f - params.roh);
+}
+
+void AntOptimizer::update_edge_pheromone(size_t edge, const float delta) {
+	float& raw = edge_pheromone[edge];
+
+	/*
+		Trail after last round was max(min, raw * scale_prev).
+		Evaporating it gives max(min * (1 - roh), raw * scale)
+	*/
+	float value = std::max(params.min_pheromone * (1.0f - params.roh), raw * pheromone_scale);
 	value += delta;
 	value = std::clamp(value, params.min_pheromone, params.max_pheromone);
+
+	raw = value / pheromone_scale;
+}
+
+bool AntOptimizer::update_pheromone(const std::vector<Ant>& ants) {
+	ranked_routes.clear();
+	for (const Ant& ant : ants) {
+		if (ant.route.length == -1) { continue; }
+		ranked_routes.push_back(&ant.route);
+	}
+
+	if (ranked_routes.empty()) { return false; }
+
+	std::sort(ranked_routes.begin(), ranked_routes.end(), [](const Route* a, const Route* b) { return a->length < b->length; });
+
+	deposits.clear();
+	update_strategy->select(ranked_routes, best_route, round, deposits);
+
+	evaporate_pheromone();
+
+	size_t hops = 0;
+	for (const Deposit& deposit : deposits) { hops += std::max<size_t>(deposit.route->nodes.size(), 1) - 1; }
+
+	// Large updates go to the colony's workers, if it keeps any
+	if (hops < parallel_deposit_threshold || !deposit_on_workers(hops)) {
+		sum_deposits();
+		apply_deposits(0, touched_edges.size());
+	}
+
+	return true;
+}
+
+void AntOptimizer::sum_deposits() {
+	touched_edges.clear();
+
+	for (const Deposit& deposit : deposits) {
+		const float amount = deposit.weight * pheromone_update(*deposit.route);
+		const auto& nodes = deposit.route->nodes;
+
+		for (auto it = std::next(nodes.begin()); it != nodes.end(); it++) {
+			size_t edge = edge_id(*std::prev(it), *it);
+			if (edge == NO_EDGE_ID) { continue; }
+			if (pheromone_delta[edge] == 0) {
+				touched_edges.push_back(edge);
+			}
+			pheromone_delta[edge] += amount;
+		}
+	}
+}
+
+void AntOptimizer::apply_deposits(size_t first, size_t last) {
+	for (size_t i = first; i < last; i++) {
+		const size_t edge = touched_edges[i];
+		update_edge_pheromone(edge, pheromone_delta[edge]);
+		pheromone_delta[edge] = 0;
+	}
+}
+
+bool AntOptimizer::deposit_on_workers(size_t hops) {
+	deposit_offsets.clear();
+	deposit_amounts.clear();
+	size_t offset = 0;
+	for (const Deposit& deposit : deposits) {
+		deposit_offsets.push_back(offset);
+		deposit_amounts.push_back(deposit.weight * pheromone_update(*deposit.route));
+		offset += std::max<size_t>(deposit.route->nodes.size(), 1) - 1;
+	}
+	deposit_offsets.push_back(offset);
+	deposit_edges.resize(hops);
+
+	// Edge ids of all hops, split evenly no matter how long the single routes are
+	const bool split = run_on_workers([&](size_t worker, size_t workers) {
+		const size_t first = hops * worker / workers, last = hops * (worker + 1) / workers;
+		size_t d = std::upper_bound(deposit_offsets.begin(), deposit_offsets.end(), first) - deposit_offsets.begin() - 1;
+		for (size_t i = first; i < last; i++) {
+			while (i >= deposit_offsets[d + 1]) { d++; }
+			const auto& nodes = deposits[d].route->nodes;
+			const size_t hop = i - deposit_offsets[d];
+			deposit_edges[i] = edge_id(nodes[hop], nodes[hop + 1]);
+		}
+	});
+	if (!split) { return false; }
+
+	/*
+		Every worker sums and applies the edges in its share of the edge ids.
+		The hops are added in the same order as by `sum_deposits`, so the trails do not depend on the number of workers.
+	*/
+	run_on_workers([&](size_t worker, size_t workers) {
+		const size_t edges = pheromone_delta.size();
+		const size_t first = edges * worker / workers, last = edges * (worker + 1) / workers;
+		std::vector<size_t> touched;
+
+		for (size_t d = 0; d + 1 < deposit_offsets.size(); d++) {
+			for (size_t i = deposit_offsets[d]; i < deposit_offsets[d + 1]; i++) {
+				const size_t edge = deposit_edges[i];
+				if (edge < first || edge >= last) { continue; }
+				if (pheromone_delta[edge] == 0) {
+					touched.push_back(edge);
+				}
+				pheromone_delta[edge] += deposit_amounts[d];
+			}
+		}
+
+		for (size_t edge : touched) {
+			update_edge_pheromone(edge, pheromone_delta[edge]);
+			pheromone_delta[edge] = 0;
+		}
+	});
+	return true;
 }
 
 bool AntOptimizer::goal_reached(const Ant& ant) const {
@@ -137,26 +368,54 @@ bool AntOptimizer::goal_reached(const Ant& ant) const {
 
 
 AntOptimizer::AntOptimizer(
-	const graph::DirectedGraph& graph,
-	const graph::DirectedGraph& sequence_graph,
-	const std::map<graph::Edge, int>& edge_weight,
+	const graph::Adjacency& graph,
+	const InstanceView& instance,
 	const std::vector<Ant>& initial_ants,
 	Parameters params)
 
-: graph(graph),
-  sequence_graph(sequence_graph), edge_weight(edge_weight), initial_ants(initial_ants), params(params) {
+: graph(graph), instance(instance), initial_ants(initial_ants), params(params) {
 	
-	for (const auto& edge : graph.edges) {
-		edge_pheromone.emplace(edge, params.initial_pheromone);
+	const size_t n = graph.node_count();
+	// Forbidden arcs are edges of the graph, but no ant should ever take them
+	auto forbidden = [&instance](graph::Node from, graph::Node to) {
+		return instance.weight(from, to) == std::numeric_limits<int32_t>::max();
+	};
+
+	edge_offsets.reserve(n + 1);
+	edge_offsets.push_back(0);
+	edge_targets.reserve(graph.edge_count());
+	for (graph::Node from = 0; from < n; from++) {
+		for (const graph::Node* to = graph.begin(from); to != graph.end(from); to++) {
+			if (forbidden(from, *to)) { continue; }
+			edge_targets.push_back(*to);
+		}
+		edge_offsets.push_back(edge_targets.size());
+	}
+	edge_targets.shrink_to_fit();
+
+	if (instance.candidate_lists() || edge_storage == EdgeStorage::sparse) {
+		sparse_edges = true;
 	}
+	else if (edge_storage == EdgeStorage::automatic) {
+		sparse_edges = edge_targets.size() < sparse_edge_density * n * n;
+	}
+
+	const size_t edge_slots = sparse_edges ? edge_targets.size() : n * n;
+	edge_pheromone.assign(edge_slots, 0);
+	edge_visibility.assign(edge_slots, 0);
+	pheromone_delta.assign(edge_slots, 0);
+
+	update_strategy = std::make_shared<IterationBestUpdate>();
+	seed_generator.seed(std::random_device()());
 
 	best_route = Route(std::numeric_limits<int>::max());
 
-	// build allowed_list for ants
+	// build allowed_list for ants: number of nodes each node depends on
 	std::vector<int> allowed_list(graph.node_count());
-	graph::DirectedGraph reverse_seq = sequence_graph.inverted();
-	for (graph::Node node = 0; node < reverse_seq.node_count(); node++) {
-		allowed_list.at(node) = reverse_seq.adjacency_list.at(node).size();
+	for (graph::Node node = 0; node < graph.node_count(); node++) {
+		for (auto it = instance.dependents_begin(node), end = instance.dependents_end(node); it != end; it++) {
+			allowed_list.at(*it) += 1;
+		}
 	}
 
 	// mark start as visited
@@ -165,23 +424,127 @@ AntOptimizer::AntOptimizer(
 		ant.allowed_nodes.at(ant.current_node) = -1;
 		ant.route.nodes.push_back(ant.current_node);
 
-		for (const graph::Node node : sequence_graph.adjacency_list.at(ant.current_node)) {
-			ant.allowed_nodes.at(node) -= 1;
+		for (auto it = instance.dependents_begin(ant.current_node), end = instance.dependents_end(ant.current_node); it != end; it++) {
+			ant.allowed_nodes.at(*it) -= 1;
 		}
 	}
 
-	// Precalculate Visibility into edge_weights
-	for (auto & p : edge_weight) {
-		this->edge_visibility.emplace(p.first, std::pow(1 / std::max(static_cast<float>(p.second), params.zero_distance), params.beta));
-	}
+	// Precalculate visibility and initial trails
+	for_all_edges([&](graph::Node from, graph::Node to, size_t edge) {
+		const float weight = instance.weight(from, to);
+		edge_visibility[edge] = std::pow(1 / std::max(weight, params.zero_distance), params.beta);
+		edge_pheromone[edge] = params.initial_pheromone;
+	});
+}
+
+bool AntOptimizer::parse_edge_storage(const std::string& name, EdgeStorage& storage) {
+	if (name == "auto") { storage = EdgeStorage::automatic; return true; }
+	if (name == "dense") { storage = EdgeStorage::dense; return true; }
+	if (name == "sparse") { storage = EdgeStorage::sparse; return true; }
+	return false;
+}
+
+void AntOptimizer::set_update_strategy(std::shared_ptr<UpdateStrategy> strategy) {
+	update_strategy = strategy;
+}
+
+void AntOptimizer::seed(unsigned int seed) {
+	seed_generator.seed(seed);
 }
 
 float AntOptimizer::pheromone(graph::Edge edge) const {
-	return edge_pheromone.count(edge) > 0 ? edge_pheromone.at(edge) : 0;
+	const size_t id = graph.has_edge(edge) ? edge_id(edge.first, edge.second) : NO_EDGE_ID;
+	return id != NO_EDGE_ID ? std::max(params.min_pheromone, edge_pheromone[id] * pheromone_scale) : 0;
+}
+
+Checkpoint AntOptimizer::snapshot() {
+	Checkpoint result;
+	result.colony = name() + (init_args.empty() ? "" : ":" + init_args);
+	result.dimension = graph.node_count();
+	result.rounds_done = rounds_done;
+	result.elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed_done).count();
+	result.round = round;
+
+	const char* p = reinterpret_cast<const char*>(&params);
+	result.params.assign(p, p + sizeof(params));
+	result.pheromone_scale = pheromone_scale;
+	result.pheromone = edge_pheromone;
+	result.best_route = best_route.nodes;
+	result.best_length = best_route.length;
+
+	std::ostringstream generator;
+	generator << seed_generator;
+	result.seed_generator = generator.str();
+
+	BinaryWriter state;
+	save_state(state);
+	result.colony_state = std::move(state.bytes);
+	return result;
+}
+
+bool AntOptimizer::restore(const Checkpoint& checkpoint, std::string& error) {
+	const std::string colony = name() + (init_args.empty() ? "" : ":" + init_args);
+	if (checkpoint.colony != colony) {
+		error = "checkpoint is of colony " + checkpoint.colony + ", not " + colony;
+		return false;
+	}
+	if (checkpoint.dimension != graph.node_count() || checkpoint.pheromone.size() != edge_pheromone.size()) {
+		error = "checkpoint is of a problem with " + std::to_string(checkpoint.dimension) + " nodes";
+		return false;
+	}
+	if (checkpoint.params.size() != sizeof(params) || std::memcmp(checkpoint.params.data(), &params, sizeof(params)) != 0) {
+		error = "checkpoint was written with different parameters";
+		return false;
+	}
+
+	std::istringstream generator(checkpoint.seed_generator);
+	generator >> seed_generator;
+	if (generator.fail()) {
+		error = "invalid random generator state";
+		return false;
+	}
+
+	BinaryReader state(checkpoint.colony_state);
+	if (!load_state(state) || !state.ok() || !state.at_end()) {
+		error = "invalid colony state";
+		return false;
+	}
+
+	rounds_done = checkpoint.rounds_done;
+	elapsed_done = std::chrono::duration_cast<Profiler::Duration>(std::chrono::microseconds(checkpoint.elapsed_us));
+	round = checkpoint.round;
+	pheromone_scale = checkpoint.pheromone_scale;
+	edge_pheromone = checkpoint.pheromone;
+	best_route.nodes = checkpoint.best_route;
+	best_route.length = checkpoint.best_length;
+	return true;
+}
+
+size_t AntOptimizer::ants_bytes(const std::vector<Ant>& ants) {
+	size_t bytes = ants.capacity() * sizeof(Ant);
+	for (const Ant& ant : ants) {
+		bytes += vector_bytes(ant.allowed_nodes) + vector_bytes(ant.route.nodes);
+	}
+	return bytes;
+}
+
+void AntOptimizer::memory_usage(MemoryReport& report) const {
+	report.add("edge_visibility", vector_bytes(edge_visibility));
+	report.add("edge_pheromone", vector_bytes(edge_pheromone));
+	report.add("pheromone_delta", vector_bytes(pheromone_delta));
+	report.add("edge_index", vector_bytes(edge_offsets) + vector_bytes(edge_targets));
+	report.add("update_scratch", vector_bytes(touched_edges) + vector_bytes(ranked_routes) + vector_bytes(deposits)
+		+ vector_bytes(deposit_offsets) + vector_bytes(deposit_amounts) + vector_bytes(deposit_edges));
+	report.add("initial_ants", ants_bytes(initial_ants));
+	report.add("best_route", vector_bytes(best_route.nodes));
 }
 
-const std::map<graph::Edge, float>& AntOptimizer::pheromone_list() const {
-	return edge_pheromone;
+std::map<graph::Edge, float> AntOptimizer::pheromone_list() const {
+	std::map<graph::Edge, float> result;
+	for_all_edges([&](graph::Node from, graph::Node to, size_t edge) {
+		result.emplace_hint(result.end(), graph::Edge(from, to), std::max(params.min_pheromone, edge_pheromone[edge] * pheromone_scale));
+	});
+	return result;
 }
 
 
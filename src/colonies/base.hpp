@@ -1,11 +1,22 @@
 #pragma once
 
+#include <atomic>
+#include <functional>
 #include <map>
 #include <random>
 #include <chrono>
 #include <algorithm>
+#include <limits>
 
 #include "../graph.hpp"
+#include "../instance.hpp"
+#include "update.hpp"
+#include "phases.hpp"
+#include "counters.hpp"
+#include "convergence.hpp"
+#include "histogram.hpp"
+#include "trace.hpp"
+#include "checkpoint.hpp"
 
 struct Route {
 	std::vector<graph::Node> nodes;
@@ -49,7 +60,32 @@ struct Profiler {
 	typedef Clock::duration Duration;
 	typedef Clock::time_point Timepoint;
 	
-	std::vector<Duration> durations;
+	/*
+		Best route length after `round`, recorded whenever it improved.
+		`elapsed` is the time spent in all rounds up to and including `round`
+	*/
+	struct Improvement {
+		int round;
+		Duration elapsed;
+		int length;
+	};
+
+	// Time per round in clock ticks (ns), bounded memory no matter how many rounds run
+	Histogram durations;
+	std::vector<Improvement> improvements;
+	Duration elapsed = Duration::zero();
+
+	/*
+		Time spent per phase, one entry per thread.
+		The first entry is the thread calling `optimize`, followed by the worker threads.
+	*/
+	std::vector<PhaseTimes> phases;
+
+	/*
+		Performance counters per thread, ordered like `phases`.
+		Empty unless the colony's `perf_counters` is set.
+	*/
+	std::vector<CounterValues> counters;
 
 	Timepoint start_point;
 
@@ -57,22 +93,61 @@ struct Profiler {
 		start_point = Clock::now();
 	}
 
-	void stop() {
-		auto elapsed = Clock::now() - start_point;
-		durations.push_back(elapsed);
+	void stop(int best_length = -1) {
+		auto duration = Clock::now() - start_point;
+		durations.record(duration.count());
+		elapsed += duration;
+
+		if (best_length < 0) { return; }
+		if (improvements.empty() || best_length < improvements.back().length) {
+			improvements.push_back(Improvement{ static_cast<int>(durations.count()), elapsed, best_length });
+		}
+	}
+
+	/*
+		Time until the best route was at most `target` long.
+		Returns a negative duration if it was never reached.
+	*/
+	Duration time_to_target(int target) const {
+		for (const auto& improvement : improvements) {
+			if (improvement.length <= target) { return improvement.elapsed; }
+		}
+		return Duration(-1);
+	}
+
+	PhaseTimes phase_total() const {
+		PhaseTimes result;
+		for (const auto& p : phases) { result += p; }
+		return result;
+	}
+
+	CounterValues counter_total() const {
+		CounterValues result;
+		for (const auto& c : counters) { result += c; }
+		return result;
+	}
+
+	size_t rounds() const {
+		return durations.count();
 	}
 
 	Duration total() const {
-		return std::accumulate(durations.begin(), durations.end(), Duration());
+		return elapsed;
 	}
 
 	Duration avg() const {
-		return total() / durations.size();
+		return rounds() > 0 ? total() / static_cast<Duration::rep>(rounds()) : Duration::zero();
 	}
 
 	std::pair<Duration, Duration> min_max() const {
-		const auto mm = std::minmax_element(durations.begin(), durations.end());
-		return std::make_pair(*mm.first, *mm.second);
+		return std::make_pair(Duration(durations.min()), Duration(durations.max()));
+	}
+
+	/*
+		Round time below which a fraction `p` (0 - 1) of all rounds finished, accurate to ~1%
+	*/
+	Duration percentile(double p) const {
+		return Duration(durations.percentile(p));
 	}
 };
 
@@ -85,6 +160,7 @@ protected:
 		Numerator of formula (7.17) in [1]
 	*/
 	float edge_value(const Ant& ant, graph::Node node) const;
+	float edge_value(const Ant& ant, graph::Node node, size_t edge) const;
 
 	/*
 		Chooses between possible next nodes of `ant`
@@ -92,6 +168,19 @@ protected:
 	*/
 	void advance_ant(Ant& ant) const;
 
+	/*
+		Marks `node` as visited by `ant` and releases nodes depending on it.
+		Does not move the ant.
+	*/
+	void visit_node(Ant& ant, graph::Node node) const;
+
+	/*
+		Closest node `ant` may visit, also outside of the graph.
+		Ants of neighbour list instances take it once all their neighbours are used up.
+		Returns graph::NO_NODE if no node is left.
+	*/
+	graph::Node fallback_node(const Ant& ant) const;
+
 	/*
 		Calculates length (sum of weights) of visiting nodes in
 		order of `route`
@@ -99,10 +188,9 @@ protected:
 	int route_length(const std::vector<graph::Node>& route) const;
 
 	/*
-		Returns pheromone trail that `ant` leavs on `edge`
-		Expects to only be called with edges `ant` actually visited
+		Returns pheromone trail that a full weight deposit of `route` leaves on each of its edges
 	*/
-	float pheromone_update(const Ant& ant, graph::Edge edge) const;
+	float pheromone_update(const Route& route) const;
 
 	/*
 		Saves the best route so far, updating if neccessary.
@@ -111,42 +199,315 @@ protected:
 	bool update_best_route(const Ant& ant);
 
 	/*
-		Responsible for updating an edge given its value and calculated delta
+		Remembers iteration best and lost ants of this round for the convergence trace
+	*/
+	void record_round(const std::vector<Ant>& ants);
+
+	/*
+		Replaces `pf.stop` at the end of every round.
+		Also streams the round to `convergence` if the best route improved or every `convergence_every` rounds.
+	*/
+	void finish_round(Profiler& pf);
+
+	/*
+		True once `cancel` was called. Colonies check it before every ant, so a stop takes effect within one ant
+	*/
+	bool cancelled() const {
+		return cancel_requested.load(std::memory_order_relaxed);
+	}
+
+	/*
+		Called once all ants of a round walked, before anything of the round is kept.
+		If cancelled the round is dropped (no best route, no deposit) and `optimize(rounds)` returns without counting it.
+	*/
+	bool abandon_round() {
+		round_abandoned = cancelled();
+		return round_abandoned;
+	}
+
+	/*
+		True once the colony should stop after the current round (SIGTERM, `cancel`, `deadline` passed)
+	*/
+	bool stop_requested() const {
+		return termination_requested() || cancel_requested.load(std::memory_order_relaxed)
+			|| (deadline != std::chrono::steady_clock::time_point::max() && std::chrono::steady_clock::now() >= deadline);
+	}
+
+	/*
+		Colony specific part of checkpoints, e.g. trails kept outside `edge_pheromone`.
+		`load_state` returns false if the data does not fit the colony.
+	*/
+	virtual void save_state(BinaryWriter& out) const {}
+	virtual bool load_state(BinaryReader& in) { return true; }
+
+	/*
+		Trace buffer for a thread of this colony, nullptr if no timeline is recorded.
+		Call before the thread starts.
+	*/
+	TraceBuffer* trace_thread(const std::string& thread_name);
+
+	/*
+		Evaporates all trails by (1 - roh).
+		Has to be called once per round, before any call to `update_edge_pheromone`.
+
+		Evaporation is folded into `pheromone_scale` so this does not touch any edge
+		(except for a renormalisation every few dozen rounds).
+	*/
+	void evaporate_pheromone();
+
+	/*
+		Responsible for updating an edge given its calculated delta.
+		Only edges with a delta need to be updated, evaporation of the other edges
+		is done by `evaporate_pheromone`.
+	*/
+	void update_edge_pheromone(size_t edge, const float delta);
+
+	/*
+		Evaporates and lets the routes chosen by `update_strategy` deposit.
+		Ants that did not reach the goal are ignored.
+		Returns false (and leaves the trails alone) if no ant reached the goal.
+	*/
+	bool update_pheromone(const std::vector<Ant>& ants);
+
+	/*
+		Sums up the deposits of `deposits` in `pheromone_delta`, every edge with a delta once in `touched_edges`
 	*/
-	void update_edge_pheromone(float& value, const float delta);
+	void sum_deposits();
+
+	/*
+		Applies and clears the deltas of touched_edges[first, last).
+	*/
+	void apply_deposits(size_t first, size_t last);
+
+	/*
+		`sum_deposits` and `apply_deposits` split over `run_on_workers`: the workers look up the edge ids of the `hops` route steps,
+		then each one sums and applies the deposits on its own range of edge ids.
+		Returns false without touching the trails if the colony has no workers.
+	*/
+	bool deposit_on_workers(size_t hops);
+
+	/*
+		Runs `task(worker, workers)` once on every worker thread the colony keeps between rounds and waits for all of them.
+		Returns false without running anything if the colony has no such workers, the caller does the work then.
+		Only called by the thread running `optimize` while no ant walks.
+	*/
+	virtual bool run_on_workers(const std::function<void(size_t worker, size_t workers)>& task) { return false; }
+
+	static constexpr size_t NO_EDGE_ID = std::numeric_limits<size_t>::max();
+
+	/*
+		Automatic storage goes sparse below this fraction of usable arcs among all node pairs.
+		Dense costs 12 bytes per node pair (visibility, trail, delta), sparse 12 bytes per arc
+		plus a binary search per `edge_id` (deposits, local updates).
+		Neighbour list instances are always sparse.
+	*/
+	static constexpr float sparse_edge_density = 0.75;
+
+	/*
+		Index of edge `from` -> `to` into the per-edge vectors.
+		NO_EDGE_ID if a neighbour list instance has no such edge (only routes through `fallback_node` have those).
+	*/
+	size_t edge_id(graph::Node from, graph::Node to) const {
+		if (!sparse_edges) {
+			return static_cast<size_t>(from) * graph.node_count() + to;
+		}
+		const auto first = edge_targets.begin() + edge_offsets[from], last = edge_targets.begin() + edge_offsets[from + 1];
+		const auto it = std::lower_bound(first, last, to);
+		return it != last && *it == to ? static_cast<size_t>(it - edge_targets.begin()) : NO_EDGE_ID;
+	}
+
+	/*
+		Calls `f(node, edge id)` for every edge starting at `from`, in ascending node order
+	*/
+	template <typename F>
+	void for_each_edge(graph::Node from, F f) const {
+		if (sparse_edges) {
+			for (size_t edge = edge_offsets[from], last = edge_offsets[from + 1]; edge < last; edge++) {
+				f(edge_targets[edge], edge);
+			}
+			return;
+		}
+
+		const size_t row = static_cast<size_t>(from) * graph.node_count();
+		for (size_t i = edge_offsets[from], last = edge_offsets[from + 1]; i < last; i++) {
+			f(edge_targets[i], row + edge_targets[i]);
+		}
+	}
+
+	/*
+		Calls `f(from, to, edge id)` for every edge that has per-edge storage
+	*/
+	template <typename F>
+	void for_all_edges(F f) const {
+		for (graph::Node from = 0; from < graph.node_count(); from++) {
+			for_each_edge(from, [&](graph::Node to, size_t edge) { f(from, to, edge); });
+		}
+	}
+
+	size_t out_degree(graph::Node from) const {
+		return edge_offsets[from + 1] - edge_offsets[from];
+	}
 
 	/*
 		Checks whether an ant has reached its goal and can be considered
 		in future analysis.
 	*/
 	bool goal_reached(const Ant& ant) const;
+
+	/*
+		Heap and inline bytes of `ants`, for `memory_usage`
+	*/
+	static size_t ants_bytes(const std::vector<Ant>& ants);
 	
 	
-	const graph::DirectedGraph& graph;
-	const graph::DirectedGraph& sequence_graph;
-	const std::map<graph::Edge, int> edge_weight;
-	std::map<graph::Edge, float> edge_visibility;
-	std::map<graph::Edge, float> edge_pheromone;
+	const graph::Adjacency& graph;
+	// Weights and precedence lists, usually straight from the memory mapped problem cache
+	const InstanceView instance;
+	/*
+		Adjacency in CSR form, the edges of `from` go to
+			edge_targets[edge_offsets[from]] .. edge_targets[edge_offsets[from + 1]]
+		Ants walk this copy of `graph` without the forbidden arcs (weight int::max).
+
+		Per-edge storage, indexed by `edge_id`, is either dense (one slot per node pair,
+		entries of pairs that are no edge are never read) or sparse: the edge id is the position in `edge_targets`,
+		so memory and per-edge loops are O(arcs). Chosen by `edge_storage`, see `sparse_edge_density`.
+		Weights stay in `instance`: a matrix read is O(1), finding the CSR position is a binary search.
+	*/
+	bool sparse_edges = false;
+	std::vector<size_t> edge_offsets;
+	std::vector<graph::Node> edge_targets;
+
+	std::vector<float> edge_visibility;
+	/*
+		Trails are stored unscaled, the actual trail is
+			max(min_pheromone, edge_pheromone * pheromone_scale)
+		The lower clamp only needs to be applied on read: untouched edges can only shrink.
+	*/
+	std::vector<float> edge_pheromone;
+	float pheromone_scale = 1;
+	static constexpr float min_pheromone_scale = 1e-12;
+
+	std::shared_ptr<UpdateStrategy> update_strategy;
+	// Route steps of all deposits from which the update is split over `run_on_workers`
+	static constexpr size_t parallel_deposit_threshold = 1 << 13;
+	// Scratch space of `update_pheromone`, `pheromone_delta` is all zero between calls
+	std::vector<float> pheromone_delta;
+	std::vector<size_t> touched_edges;
+	std::vector<const Route*> ranked_routes;
+	std::vector<Deposit> deposits;
+	// Scratch space of `deposit_on_workers`: first hop and amount of every deposit, edge id of every hop
+	std::vector<size_t> deposit_offsets;
+	std::vector<float> deposit_amounts;
+	std::vector<size_t> deposit_edges;
 	std::vector<Ant> initial_ants;
-	std::random_device rand_device;
+	// Phase times of the thread calling `optimize`
+	PhaseTimes phase_times;
+	// Set by `record_round`
+	int iteration_best = -1;
+	int lost_ants = 0;
+	// Best length `on_improvement` was last called with
+	int notified_length = -1;
+	std::atomic<bool> cancel_requested{ false };
+	// Set by `abandon_round`
+	bool round_abandoned = false;
+	// Seeds the ants' generators every round. Seeded from std::random_device unless `seed` is called
+	std::mt19937 seed_generator;
 public:
+	enum class EdgeStorage { automatic, dense, sparse };
+	// Storage of colonies built from now on, set from the command line before any colony exists
+	static inline EdgeStorage edge_storage = EdgeStorage::automatic;
+	// auto, dense or sparse
+	static bool parse_edge_storage(const std::string& name, EdgeStorage& storage);
+
 	const Parameters params;
 	int round = 0;
 	Route best_route;
 	std::string init_args;
+	// Count cycles, cache misses, ... of every thread during `optimize(rounds)`
+	bool perf_counters = false;
+	// Anytime curve of `optimize(rounds)`, not owned. Disabled if nullptr
+	ConvergenceWriter* convergence = nullptr;
+	int convergence_every = 0;
+	// Records every phase of every thread as timeline, not owned. Disabled if nullptr
+	TraceRecorder* trace = nullptr;
+	// Gets a snapshot every `checkpoint_every` rounds and when stopped by SIGTERM, not owned. Disabled if nullptr
+	CheckpointWriter* checkpoint = nullptr;
+	int checkpoint_every = 0;
+	/*
+		Rounds `optimize(rounds)` finished over the colony's lifetime, including those of a restored checkpoint.
+		May be read from other threads while the colony runs
+	*/
+	std::atomic<int> rounds_done{ 0 };
+	// Time spent in those rounds
+	Profiler::Duration elapsed_done = Profiler::Duration::zero();
+	// Called after every round that shortened `best_route`, on the thread running `optimize`. Disabled if empty
+	std::function<void(const AntOptimizer&)> on_improvement;
+	// `optimize(rounds)` stops after the round that ends past this point
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
 
 	AntOptimizer(
-		const graph::DirectedGraph& graph,
-		const graph::DirectedGraph& sequence_graph,
-		const std::map<graph::Edge, int>& edge_weight,
+		const graph::Adjacency& graph,
+		const InstanceView& instance,
 		const std::vector<Ant>& initial_ants,
 		Parameters params);
 
 	virtual ~AntOptimizer() = default;
 
+	/*
+		Offers `route` as best route, e.g. to seed the colony with a known solution.
+		Routes with negative length are considered invalid and ignored.
+	*/
+	bool update_best_route(const Route& route);
+
+	/*
+		Starts the colony near `route`, e.g. a tour of an earlier run: offers it as best route and moves
+		the initial trails a fraction `strength` (0 - 1) of the way to max_pheromone on its edges
+		and to min_pheromone on all others. 0 only sets the best route.
+		Call after `init`, before the first `optimize`.
+	*/
+	virtual void warm_start(const Route& route, float strength);
+
+	/*
+		Replaces the update strategy of colonies with Max-Min pheromone update.
+		Default: iteration-best
+	*/
+	void set_update_strategy(std::shared_ptr<UpdateStrategy> strategy);
+
+	/*
+		Makes the ants' random choices reproducible.
+		Only colonies running the same ants on the same number of threads repeat exactly.
+	*/
+	void seed(unsigned int seed);
+
+	/*
+		Lets `optimize(rounds)` return before the next ant starts, the round in progress is dropped.
+		Safe to call from any thread
+	*/
+	void cancel() {
+		cancel_requested.store(true, std::memory_order_relaxed);
+	}
+
 	float pheromone(graph::Edge edge) const;
 	std::pair<float, float> minmax_pheromone() const;
-	const std::map<graph::Edge, float>& pheromone_list() const;
+	std::map<graph::Edge, float> pheromone_list() const;
+
+	/*
+		Adds the bytes of every structure the colony keeps to `report`.
+		Temporaries of a round (e.g. the ants of the serial colony) only show up in the peak RSS.
+	*/
+	virtual void memory_usage(MemoryReport& report) const;
+
+	/*
+		Copy of the complete state, cheap enough to take between two rounds.
+		Problem, update strategy and rounds are filled in by the CheckpointWriter.
+	*/
+	Checkpoint snapshot();
+
+	/*
+		Continues from `checkpoint`. Call after `init`, before `optimize`.
+		Returns false and explains in `error` if the checkpoint belongs to a different colony or problem.
+	*/
+	bool restore(const Checkpoint& checkpoint, std::string& error);
 
 	virtual void init(std::string args) {}
 
@@ -1,6 +1,10 @@
 #pragma once
 #include <pthread.h>
 #include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+#include <thread>
 
 #include "base.hpp"
 #include "../semaphore.hpp"
@@ -10,98 +14,155 @@ private:
 	struct ThreadArgs {
 		Ant* start_ant;
 		int ant_count;
+		size_t index;
 		BatchedAntOptimizer& optimizer;
 		bool cancelled = false;
+		PhaseTimes phases = {};
+		CounterValues counters = {};
 	};
 
 	static void* optimize_threaded(void* __args) {
 		ThreadArgs* args = static_cast<ThreadArgs*>(__args);
+		PerfCounters counters(args->optimizer.perf_counters);
 
 		while (true) {
-			args->optimizer.start_line.inc_and_wait(0);
-			if (args->cancelled) { return nullptr; }
+			{
+				ScopedPhase phase(args->phases, Phase::barrier);
+				args->optimizer.start_line.inc_and_wait(0);
+			}
+			if (args->cancelled) {
+				args->counters = counters.read();
+				return nullptr;
+			}
+			if (args->optimizer.worker_task != nullptr) {
+				{
+					ScopedPhase phase(args->phases, Phase::update);
+					(*args->optimizer.worker_task)(args->index, args->optimizer.threads.size());
+				}
+				ScopedPhase phase(args->phases, Phase::barrier);
+				args->optimizer.finish_line.inc_and_wait(0);
+				continue;
+			}
 
 			const Ant* end_ant = args->start_ant + args->ant_count;
 			for (Ant* ant = args->start_ant; ant != end_ant; ant++) {
-				for (int i = 0; i < args->optimizer.graph.node_count() - 1; i++) {
-					args->optimizer.advance_ant(*ant);
-					if (ant->current_node == graph::NO_NODE) { break; }
+				if (args->optimizer.cancelled()) { break; }
+
+				{
+					ScopedPhase phase(args->phases, Phase::construction);
+					for (int i = 0; i < args->optimizer.graph.node_count() - 1; i++) {
+						args->optimizer.advance_ant(*ant);
+						if (ant->current_node == graph::NO_NODE) { break; }
+					}
 				}
 
 				if (!args->optimizer.goal_reached(*ant)) { continue; }
 
+				ScopedPhase phase(args->phases, Phase::evaluation);
 				ant->route.length = args->optimizer.route_length(ant->route.nodes);
 			}
 
+			ScopedPhase phase(args->phases, Phase::barrier);
 			args->optimizer.finish_line.inc_and_wait(0);
 		}
 	}
 
 	Semaphore start_line = Semaphore(0);
 	Semaphore finish_line = Semaphore(0);
+	// Run by the workers instead of walking ants, see `run_on_workers`
+	const std::function<void(size_t, size_t)>* worker_task = nullptr;
 
 	std::vector<pthread_t> threads;
 	std::vector<ThreadArgs> thread_args;
 	std::vector<Ant> ants;
 	size_t batch_size = 1;
+
+	// Lets the workers waiting at the start line return and joins them
+	void stop_workers() {
+		start_line.wait_and_lock(threads.size());
+
+			for (auto & args : thread_args) { args.cancelled = true; }
+			start_line.set(0);
+
+		start_line.unlock();
+
+		for (const auto & thread : threads) {
+			pthread_join(thread, nullptr);
+		}
+	}
 public:
 	using AntOptimizer::AntOptimizer;
 
 	static constexpr const char* _name = "batched";
 	std::string name() override { return _name; }
 
+	void memory_usage(MemoryReport& report) const override {
+		AntOptimizer::memory_usage(report);
+		report.add("ants", ants_bytes(ants));
+	}
+
 	void init(std::string args) override {
-		batch_size = std::stoi(args);
+		const int size = std::stoi(args);
+		if (size < 1) { throw std::invalid_argument("batched needs at least 1 ant per batch: " + args); }
+		batch_size = size;
 	}
 
 	void optimize() override {
 		// Init Ants
-		for (int i = 0; i < initial_ants.size(); i++) {
-			ants[i] = initial_ants[i];
-			ants[i].generator.seed(rand_device());
+		{
+			ScopedPhase phase(phase_times, Phase::reset);
+			for (int i = 0; i < initial_ants.size(); i++) {
+				ants[i] = initial_ants[i];
+				ants[i].generator.seed(seed_generator());
+			}
 		}
-		const Ant* best_ant = nullptr;
 
-		// Wait for all threads on start line ; Let threads run
-		//sem_wait_and_reset(threads.size());
-		start_line.wait_and_reset(threads.size());
+		{
+			ScopedPhase phase(phase_times, Phase::barrier);
 
-		// Wait for all threads at finish line ; let them go back to start
-		//sem_wait_and_reset(threads.size());
-		finish_line.wait_and_reset(threads.size());
+			// Wait for all threads on start line ; Let threads run
+			//sem_wait_and_reset(threads.size());
+			start_line.wait_and_reset(threads.size());
 
+			// Wait for all threads at finish line ; let them go back to start
+			//sem_wait_and_reset(threads.size());
+			finish_line.wait_and_reset(threads.size());
+		}
 
-		for (Ant & ant : ants) {
-			if (ant.route.length == -1) { continue; }
+		if (abandon_round()) { return; }
 
-			update_best_route(ant);
-			if (best_ant == nullptr || ant.route.length < best_ant->route.length) {
-				best_ant = &ant;
-			}
-		}
+		{
+			ScopedPhase phase(phase_times, Phase::reduction);
+			record_round(ants);
+			for (Ant & ant : ants) {
+				if (ant.route.length == -1) { continue; }
 
-		/*
-			We don't need to initialize this.
-			We call the `[]`-operator, which creates entries with the default initializer
-			The default initializer for float returns 0.0, which is what we would initialize this to.
-		*/
-		std::map<graph::Edge, float> delta_pheromone;
-
-		if (best_ant == nullptr) return;
-		for (auto it = std::next(best_ant->route.nodes.begin()); it != best_ant->route.nodes.end(); it++) {
-			graph::Edge edge(*std::prev(it), *it);
-			delta_pheromone[edge] += pheromone_update(*best_ant, edge);
+				update_best_route(ant);
+			}
 		}
 
-		for (auto& edge_pair : edge_pheromone) {
-			update_edge_pheromone(edge_pair.second, delta_pheromone.count(edge_pair.first) > 0 ? delta_pheromone.at(edge_pair.first) : 0);
-		}
+		ScopedPhase phase(phase_times, Phase::update);
+		if (!update_pheromone(ants)) return;
 		
 		round++;
 	}
 
+	bool run_on_workers(const std::function<void(size_t worker, size_t workers)>& task) override {
+		if (threads.size() < 2) { return false; }
+
+		// Counted as update phase of the calling thread
+		worker_task = &task;
+		start_line.wait_and_reset(threads.size());
+		finish_line.wait_and_reset(threads.size());
+		worker_task = nullptr;
+		return true;
+	}
+
 	Profiler optimize(int rounds) override {
 		Profiler pf;
+		phase_times.clear();
+		phase_times.trace = trace_thread("main");
+		PerfCounters counters(perf_counters);
 
 		ants = initial_ants;
 		size_t first_ant = 0;
@@ -110,36 +171,43 @@ public:
 			thread_args.emplace_back(ThreadArgs{
 				&ants.at(first_ant),
 				ant_count,
+				thread_args.size(),
 				*this
 			});
 			first_ant += ant_count;
 		}
 
 		for (auto & args : thread_args) {
+			args.phases.trace = trace_thread("worker " + std::to_string(threads.size()));
 			threads.emplace_back();
 			int succ = pthread_create(&threads.back(), nullptr, optimize_threaded, static_cast<void*>(&args));
 			if (succ != 0) {
-				exit(4);
+				// The workers started so far wait at the start line
+				threads.pop_back();
+				stop_workers();
+				threads.clear();
+				thread_args.clear();
+				throw std::system_error(succ, std::generic_category(), "pthread_create");
 			}
 		}
 	
-		while (rounds-- > 0) {
+		while (rounds-- > 0 && !stop_requested()) {
 			pf.start();
 			optimize();
-			pf.stop();
+			if (round_abandoned) { break; }
+			finish_round(pf);
 		}
 
-		// Bring all threads to a stop
-		start_line.wait_and_lock(threads.size());
-
-			for (auto & args : thread_args) { args.cancelled = true; }
-			start_line.set(0);
-
-		start_line.unlock();
+		stop_workers();
 
-		for (const auto & thread : threads) {
-			pthread_join(thread, nullptr);
+		pf.phases.push_back(phase_times);
+		for (const auto & args : thread_args) { pf.phases.push_back(args.phases); }
+		if (perf_counters) {
+			pf.counters.push_back(counters.read());
+			for (const auto & args : thread_args) { pf.counters.push_back(args.counters); }
 		}
+		threads.clear();
+		thread_args.clear();
 
 		return pf;
 	}
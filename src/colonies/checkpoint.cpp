@@ -0,0 +1,153 @@
+#include <atomic>
+#include <csignal>
+#include <fstream>
+#include <system_error>
+
+#include <unistd.h>
+
+#include "checkpoint.hpp"
+
+bool write_checkpoint(const std::filesystem::path& path, const Checkpoint& checkpoint) {
+	BinaryWriter out;
+	for (char c : Checkpoint::magic) { out.put(c); }
+	out.put(checkpoint.colony);
+	out.put(checkpoint.update);
+	out.put(checkpoint.problem);
+	out.put(checkpoint.dimension);
+	out.put(checkpoint.rounds);
+	out.put(checkpoint.rounds_done);
+	out.put(checkpoint.elapsed_us);
+	out.put(checkpoint.round);
+	out.put(checkpoint.params);
+	out.put(checkpoint.pheromone_scale);
+	out.put(checkpoint.pheromone);
+	out.put(checkpoint.best_route);
+	out.put(checkpoint.best_length);
+	out.put(checkpoint.seed_generator);
+	out.put(checkpoint.colony_state);
+
+	const std::filesystem::path temporary = path.string() + ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(out.bytes.data(), out.bytes.size());
+		file.flush();
+		if (!file.good()) {
+			file.close();
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, path, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
+
+bool read_checkpoint(const std::filesystem::path& path, Checkpoint& checkpoint) {
+	std::ifstream file(path, std::ios::binary);
+	if (!file) { return false; }
+	std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	BinaryReader in(bytes);
+	for (char expected : Checkpoint::magic) {
+		char c;
+		if (!in.get(c) || c != expected) { return false; }
+	}
+
+	in.get(checkpoint.colony);
+	in.get(checkpoint.update);
+	in.get(checkpoint.problem);
+	in.get(checkpoint.dimension);
+	in.get(checkpoint.rounds);
+	in.get(checkpoint.rounds_done);
+	in.get(checkpoint.elapsed_us);
+	in.get(checkpoint.round);
+	in.get(checkpoint.params);
+	in.get(checkpoint.pheromone_scale);
+	in.get(checkpoint.pheromone);
+	in.get(checkpoint.best_route);
+	in.get(checkpoint.best_length);
+	in.get(checkpoint.seed_generator);
+	in.get(checkpoint.colony_state);
+	return in.ok() && in.at_end();
+}
+
+CheckpointWriter::CheckpointWriter(const std::filesystem::path& path, const std::string& problem, const std::string& update, int rounds)
+	: path(path), problem(problem), update(update), rounds(rounds) {
+	writer = std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopped = true;
+	}
+	wake.notify_one();
+	writer.join();
+}
+
+void CheckpointWriter::submit(Checkpoint&& checkpoint) {
+	checkpoint.problem = problem;
+	checkpoint.update = update;
+	checkpoint.rounds = rounds;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		pending = std::make_unique<Checkpoint>(std::move(checkpoint));
+	}
+	wake.notify_one();
+}
+
+void CheckpointWriter::flush() {
+	std::unique_lock<std::mutex> lock(mutex);
+	idle.wait(lock, [this]() { return pending == nullptr && !writing; });
+}
+
+size_t CheckpointWriter::written() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return written_count;
+}
+
+size_t CheckpointWriter::failed() {
+	std::lock_guard<std::mutex> lock(mutex);
+	return failed_count;
+}
+
+void CheckpointWriter::run() {
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true) {
+		wake.wait(lock, [this]() { return pending != nullptr || stopped; });
+		if (pending == nullptr) { break; }
+
+		std::unique_ptr<Checkpoint> checkpoint = std::move(pending);
+		writing = true;
+		lock.unlock();
+		bool ok = write_checkpoint(path, *checkpoint);
+		lock.lock();
+		writing = false;
+		(ok ? written_count : failed_count)++;
+		idle.notify_all();
+	}
+}
+
+namespace {
+	std::atomic<bool> termination{ false };
+	static_assert(std::atomic<bool>::is_always_lock_free, "the signal handler needs a lock free flag");
+
+	void on_termination(int) {
+		termination.store(true, std::memory_order_relaxed);
+	}
+}
+
+void install_termination_handler() {
+	std::signal(SIGTERM, on_termination);
+	std::signal(SIGINT, on_termination);
+}
+
+bool termination_requested() {
+	return termination.load(std::memory_order_relaxed);
+}
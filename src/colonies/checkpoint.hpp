@@ -0,0 +1,175 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/*
+	Appends trivially copyable values, vectors and strings to a byte buffer (native byte order)
+*/
+class BinaryWriter {
+public:
+	std::vector<char> bytes;
+
+	template <typename T>
+	void put(const T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+		const char* p = reinterpret_cast<const char*>(&value);
+		bytes.insert(bytes.end(), p, p + sizeof(T));
+	}
+
+	template <typename T>
+	void put(const std::vector<T>& values) {
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be written");
+		put<uint64_t>(values.size());
+		const char* p = reinterpret_cast<const char*>(values.data());
+		bytes.insert(bytes.end(), p, p + values.size() * sizeof(T));
+	}
+
+	void put(const std::string& value) {
+		put(std::vector<char>(value.begin(), value.end()));
+	}
+};
+
+/*
+	Reads what BinaryWriter wrote. Every `get` returns false (and keeps failing) once the data runs out.
+*/
+class BinaryReader {
+private:
+	const char* position;
+	const char* end;
+	bool failed = false;
+public:
+	BinaryReader(const char* data, size_t size) : position(data), end(data + size) {}
+	explicit BinaryReader(const std::vector<char>& data) : BinaryReader(data.data(), data.size()) {}
+
+	bool ok() const { return !failed; }
+	bool at_end() const { return position == end; }
+
+	template <typename T>
+	bool get(T& value) {
+		static_assert(std::is_trivially_copyable<T>::value, "only plain values can be read");
+		if (failed || static_cast<size_t>(end - position) < sizeof(T)) { return fail(); }
+		std::memcpy(&value, position, sizeof(T));
+		position += sizeof(T);
+		return true;
+	}
+
+	template <typename T>
+	bool get(std::vector<T>& values) {
+		uint64_t count;
+		if (!get(count) || count > static_cast<size_t>(end - position) / sizeof(T)) { return fail(); }
+		values.resize(count);
+		std::memcpy(values.data(), position, count * sizeof(T));
+		position += count * sizeof(T);
+		return true;
+	}
+
+	bool get(std::string& value) {
+		std::vector<char> chars;
+		if (!get(chars)) { return false; }
+		value.assign(chars.begin(), chars.end());
+		return true;
+	}
+
+	bool fail() {
+		failed = true;
+		return false;
+	}
+};
+
+/*
+	Everything needed to continue a run: the colony's state after `rounds_done` rounds.
+	Colony specific state (e.g. the ACS trails) is kept opaque in `colony_state`.
+*/
+struct Checkpoint {
+	static constexpr char magic[8] = { 'A', 'N', 'T', 'C', 'K', 'P', 'T', '2' };
+
+	// Identify what the checkpoint belongs to
+	std::string colony;
+	std::string update;
+	std::string problem;
+	int32_t dimension = 0;
+
+	// Rounds the run was started with and rounds done so far
+	int32_t rounds = 0;
+	int32_t rounds_done = 0;
+	// Time spent in those rounds, so the convergence trace of a resumed run continues
+	int64_t elapsed_us = 0;
+
+	int32_t round = 0;
+	// Parameters, compared byte wise on restore
+	std::vector<char> params;
+	float pheromone_scale = 1;
+	std::vector<float> pheromone;
+	std::vector<int32_t> best_route;
+	int32_t best_length = -1;
+	// std::mt19937 in its text representation
+	std::string seed_generator;
+	std::vector<char> colony_state;
+};
+
+/*
+	Writes `checkpoint` to a temporary file next to `path` and renames it over `path`,
+	so `path` always holds a complete checkpoint
+*/
+bool write_checkpoint(const std::filesystem::path& path, const Checkpoint& checkpoint);
+
+/*
+	Returns false if `path` can not be read or is no checkpoint
+*/
+bool read_checkpoint(const std::filesystem::path& path, Checkpoint& checkpoint);
+
+/*
+	Writes checkpoints on a background thread, so the colony only pays for taking the snapshot.
+	Only the newest snapshot waiting to be written is kept.
+*/
+class CheckpointWriter {
+private:
+	std::filesystem::path path;
+	std::string problem;
+	std::string update;
+	int rounds;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable idle;
+	std::unique_ptr<Checkpoint> pending;
+	bool writing = false;
+	bool stopped = false;
+	size_t written_count = 0;
+	size_t failed_count = 0;
+	std::thread writer;
+
+	void run();
+public:
+	CheckpointWriter(const std::filesystem::path& path, const std::string& problem, const std::string& update, int rounds);
+	~CheckpointWriter();
+
+	CheckpointWriter(const CheckpointWriter&) = delete;
+	CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+	// Fills in problem, update strategy and rounds and queues the snapshot
+	void submit(Checkpoint&& checkpoint);
+
+	// Blocks until every submitted snapshot is on disk
+	void flush();
+
+	size_t written();
+	size_t failed();
+	const std::filesystem::path& file() const { return path; }
+};
+
+/*
+	Lets SIGTERM (and SIGINT) set `termination_requested` instead of killing the process,
+	colonies then stop after the current round
+*/
+void install_termination_handler();
+bool termination_requested();
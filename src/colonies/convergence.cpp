@@ -0,0 +1,58 @@
+#include <chrono>
+
+#include "convergence.hpp"
+
+ConvergenceWriter::ConvergenceWriter(const std::filesystem::path& path, const std::string& prefix) : ring(capacity), prefix(prefix) {
+	bool new_file = !std::filesystem::is_regular_file(path);
+	file.open(path, std::ios::app);
+	if (new_file) {
+		file << "run;round;elapsed_µs;iteration_best;global_best;lost_ants;" << "\n";
+	}
+
+	writer = std::thread(&ConvergenceWriter::run, this);
+}
+
+ConvergenceWriter::~ConvergenceWriter() {
+	stopped.store(true, std::memory_order_release);
+	writer.join();
+	drain();
+	file.flush();
+}
+
+bool ConvergenceWriter::push(const ConvergencePoint& point) {
+	size_t h = head.load(std::memory_order_relaxed);
+	if (h - tail.load(std::memory_order_acquire) >= capacity) {
+		dropped_points.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	}
+
+	ring[h % capacity] = point;
+	head.store(h + 1, std::memory_order_release);
+	return true;
+}
+
+void ConvergenceWriter::drain() {
+	size_t t = tail.load(std::memory_order_relaxed);
+	const size_t h = head.load(std::memory_order_acquire);
+
+	for (; t != h; t++) {
+		const ConvergencePoint& p = ring[t % capacity];
+		file
+			<< prefix << ";"
+			<< p.round << ";"
+			<< p.elapsed_us << ";"
+			<< p.iteration_best << ";"
+			<< p.global_best << ";"
+			<< p.lost_ants << ";"
+			<< "\n";
+	}
+
+	tail.store(t, std::memory_order_release);
+}
+
+void ConvergenceWriter::run() {
+	while (!stopped.load(std::memory_order_acquire)) {
+		drain();
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+	}
+}
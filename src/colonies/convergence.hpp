@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+	One sample of the anytime curve of a colony
+*/
+struct ConvergencePoint {
+	int round;
+	int64_t elapsed_us;
+	int iteration_best; // -1 if no ant reached the goal
+	int global_best;
+	int lost_ants;      // Ants that got stuck before reaching the goal
+};
+
+/*
+	Appends convergence points to a CSV file without ever blocking the optimizer.
+
+	`push` only writes into a fixed size single producer / single consumer ring,
+	a background thread drains it into the file. If the ring is full the point is
+	dropped and counted instead of waiting.
+	Every line starts with `prefix`, e.g. colony and seed of the run.
+*/
+class ConvergenceWriter {
+private:
+	static constexpr size_t capacity = 1 << 12;
+
+	std::vector<ConvergencePoint> ring;
+	std::atomic<size_t> head = 0; // Next slot to write, owned by the producer
+	std::atomic<size_t> tail = 0; // Next slot to read, owned by the writer thread
+	std::atomic<size_t> dropped_points = 0;
+	std::atomic<bool> stopped = false;
+
+	std::ofstream file;
+	std::string prefix;
+	std::thread writer;
+
+	void drain();
+	void run();
+public:
+	ConvergenceWriter(const std::filesystem::path& path, const std::string& prefix);
+
+	// Writes everything still in the ring
+	~ConvergenceWriter();
+
+	ConvergenceWriter(const ConvergenceWriter&) = delete;
+	ConvergenceWriter& operator=(const ConvergenceWriter&) = delete;
+
+	/*
+		Called by the optimizer, returns false if the point had to be dropped
+	*/
+	bool push(const ConvergencePoint& point);
+
+	size_t dropped() const { return dropped_points.load(std::memory_order_relaxed); }
+};
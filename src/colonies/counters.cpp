@@ -0,0 +1,142 @@
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "counters.hpp"
+
+const char* counter_name(Counter counter) {
+	switch (counter) {
+		case Counter::cycles:           return "cycles";
+		case Counter::instructions:     return "instructions";
+		case Counter::l1d_misses:       return "l1d_misses";
+		case Counter::llc_misses:       return "llc_misses";
+		case Counter::branch_misses:    return "branch_misses";
+		case Counter::context_switches: return "context_switches";
+		default:                        return "unknown";
+	}
+}
+
+#ifdef __linux__
+namespace {
+	perf_event_attr counter_attr(Counter counter) {
+		perf_event_attr attr;
+		std::memset(&attr, 0, sizeof(attr));
+		attr.size = sizeof(attr);
+		attr.type = PERF_TYPE_HARDWARE;
+		attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+		switch (counter) {
+			case Counter::cycles:
+				attr.config = PERF_COUNT_HW_CPU_CYCLES;
+				break;
+			case Counter::instructions:
+				attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+				break;
+			case Counter::l1d_misses:
+				attr.type = PERF_TYPE_HW_CACHE;
+				attr.config = PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+				break;
+			case Counter::llc_misses:
+				attr.config = PERF_COUNT_HW_CACHE_MISSES;
+				break;
+			case Counter::branch_misses:
+				attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+				break;
+			case Counter::context_switches:
+				attr.type = PERF_TYPE_SOFTWARE;
+				attr.config = PERF_COUNT_SW_CONTEXT_SWITCHES;
+				break;
+			default:
+				break;
+		}
+		return attr;
+	}
+
+	/*
+		Opens `counter` for the calling thread on any cpu.
+		Retries without kernel events, which is all perf_event_paranoid=2 allows.
+	*/
+	int open_counter(Counter counter) {
+		perf_event_attr attr = counter_attr(counter);
+		int fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			fd = syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+		}
+		return fd;
+	}
+}
+
+PerfCounters::PerfCounters(bool enabled) {
+	fds.fill(-1);
+	if (!enabled) { return; }
+
+	for (size_t i = 0; i < fds.size(); i++) {
+		fds[i] = open_counter(static_cast<Counter>(i));
+	}
+}
+
+PerfCounters::~PerfCounters() {
+	for (int fd : fds) {
+		if (fd >= 0) { close(fd); }
+	}
+}
+
+CounterValues PerfCounters::read() const {
+	CounterValues result;
+	for (size_t i = 0; i < fds.size(); i++) {
+		if (fds[i] < 0) { continue; }
+
+		// value, time enabled, time running
+		uint64_t data[3];
+		if (::read(fds[i], data, sizeof(data)) != sizeof(data)) { continue; }
+
+		// Counter was never scheduled, happens if there are more events than hardware counters
+		if (data[2] == 0) { continue; }
+
+		result.values[i] = data[2] < data[1]
+			? static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2])
+			: data[0];
+		result.valid[i] = true;
+	}
+	return result;
+}
+
+bool PerfCounters::supported(std::string& reason) {
+	int fd = open_counter(Counter::cycles);
+	if (fd < 0) {
+		reason = std::strerror(errno);
+		if (errno == EACCES || errno == EPERM) {
+			reason += " (check /proc/sys/kernel/perf_event_paranoid)";
+		}
+		else if (errno == ENOENT || errno == EOPNOTSUPP) {
+			reason += " (no hardware counters, e.g. in a virtual machine)";
+		}
+		return false;
+	}
+	close(fd);
+	return true;
+}
+#else
+PerfCounters::PerfCounters(bool enabled) {
+	fds.fill(-1);
+}
+
+PerfCounters::~PerfCounters() {}
+
+CounterValues PerfCounters::read() const {
+	return CounterValues();
+}
+
+bool PerfCounters::supported(std::string& reason) {
+	reason = "perf_event_open is only available on linux";
+	return false;
+}
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+/*
+	Events counted by `PerfCounters`
+*/
+enum class Counter {
+	cycles,
+	instructions,
+	l1d_misses,       // L1 data cache read misses
+	llc_misses,       // Last level cache misses
+	branch_misses,
+	context_switches,
+	count
+};
+
+const char* counter_name(Counter counter);
+
+/*
+	Counter readings of one thread.
+	Events that could not be opened are not `valid` and read as 0.
+*/
+struct CounterValues {
+	std::array<uint64_t, static_cast<size_t>(Counter::count)> values{};
+	std::array<bool, static_cast<size_t>(Counter::count)> valid{};
+
+	uint64_t get(Counter counter) const {
+		return values[static_cast<size_t>(counter)];
+	}
+
+	bool has(Counter counter) const {
+		return valid[static_cast<size_t>(counter)];
+	}
+
+	bool any() const {
+		for (bool v : valid) { if (v) return true; }
+		return false;
+	}
+
+	CounterValues& operator+=(const CounterValues& other) {
+		for (size_t i = 0; i < values.size(); i++) {
+			values[i] += other.values[i];
+			valid[i] = valid[i] || other.valid[i];
+		}
+		return *this;
+	}
+};
+
+/*
+	Counts hardware and software events of the calling thread with perf_event_open (Linux only).
+	Counting starts on construction. Every event is opened on its own, so an event the
+	(virtual) CPU doesn't support or the user may not access is simply missing from `read`.
+	Constructing with `enabled = false` or on other platforms opens nothing.
+*/
+class PerfCounters {
+private:
+	std::array<int, static_cast<size_t>(Counter::count)> fds;
+public:
+	explicit PerfCounters(bool enabled = true);
+	~PerfCounters();
+
+	PerfCounters(const PerfCounters&) = delete;
+	PerfCounters& operator=(const PerfCounters&) = delete;
+
+	/*
+		Values since construction, scaled up if the kernel had to multiplex the counters
+	*/
+	CounterValues read() const;
+
+	/*
+		Checks whether the cycle counter can be opened, `reason` describes why not
+	*/
+	static bool supported(std::string& reason);
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+/*
+	Log bucketed histogram in the style of HdrHistogram.
+
+	Values below 2^sub_bucket_bits get their own bucket, above that every power of two
+	is split into 2^(sub_bucket_bits - 1) equally sized buckets. With 7 bits a bucket
+	is at most 1/64 of its value wide, queries return the bucket's midpoint so the
+	error stays below 1%. Memory is fixed (~30KB) no matter how many values are recorded.
+	Minimum, maximum and sum are tracked exactly.
+*/
+class Histogram {
+private:
+	static constexpr int sub_bucket_bits = 7;
+	static constexpr uint64_t sub_bucket_count = uint64_t(1) << sub_bucket_bits;
+	static constexpr uint64_t sub_bucket_half = sub_bucket_count / 2;
+	static constexpr size_t bucket_count = sub_bucket_count + (64 - sub_bucket_bits) * sub_bucket_half;
+
+	std::array<uint64_t, bucket_count> counts{};
+	uint64_t total_count = 0;
+	uint64_t value_sum = 0;
+	uint64_t min_value = std::numeric_limits<uint64_t>::max();
+	uint64_t max_value = 0;
+
+	static int highest_bit(uint64_t value) {
+		return 63 - __builtin_clzll(value);
+	}
+
+	static size_t index_of(uint64_t value) {
+		if (value < sub_bucket_count) { return value; }
+
+		// Shift so the value lands in [half, count) of its sub buckets
+		int shift = highest_bit(value) - (sub_bucket_bits - 1);
+		return sub_bucket_count + (shift - 1) * sub_bucket_half + ((value >> shift) - sub_bucket_half);
+	}
+
+	// Smallest value and width of bucket `index`
+	static std::pair<uint64_t, uint64_t> bucket_range(size_t index) {
+		if (index < sub_bucket_count) { return { index, 1 }; }
+
+		int shift = (index - sub_bucket_count) / sub_bucket_half + 1;
+		uint64_t sub_bucket = (index - sub_bucket_count) % sub_bucket_half + sub_bucket_half;
+		return { sub_bucket << shift, uint64_t(1) << shift };
+	}
+public:
+	void record(uint64_t value, uint64_t count = 1) {
+		if (count == 0) { return; }
+		counts[index_of(value)] += count;
+		total_count += count;
+		value_sum += value * count;
+		min_value = std::min(min_value, value);
+		max_value = std::max(max_value, value);
+	}
+
+	/*
+		Calls `f(value, count)` for every non empty bucket in ascending order.
+		`value` is the bucket's midpoint, recording it again lands in the same bucket.
+	*/
+	template <typename F>
+	void for_each(F f) const {
+		for (size_t i = 0; i < bucket_count; i++) {
+			if (counts[i] == 0) { continue; }
+			auto range = bucket_range(i);
+			f(range.first + range.second / 2, counts[i]);
+		}
+	}
+
+	/*
+		Value below which a fraction `p` (0 - 1) of all recorded values lie
+	*/
+	uint64_t percentile(double p) const {
+		if (total_count == 0) { return 0; }
+
+		uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * total_count)));
+		uint64_t seen = 0;
+		for (size_t i = 0; i < bucket_count; i++) {
+			seen += counts[i];
+			if (seen >= rank) {
+				auto range = bucket_range(i);
+				return std::clamp(range.first + range.second / 2, min_value, max_value);
+			}
+		}
+		return max_value;
+	}
+
+	/*
+		Adds all values of `other`, e.g. to combine threads or trials
+	*/
+	Histogram& operator+=(const Histogram& other) {
+		for (size_t i = 0; i < bucket_count; i++) {
+			counts[i] += other.counts[i];
+		}
+		total_count += other.total_count;
+		value_sum += other.value_sum;
+		min_value = std::min(min_value, other.min_value);
+		max_value = std::max(max_value, other.max_value);
+		return *this;
+	}
+
+	uint64_t count() const { return total_count; }
+	uint64_t sum() const { return value_sum; }
+	uint64_t min() const { return total_count > 0 ? min_value : 0; }
+	uint64_t max() const { return max_value; }
+	double mean() const { return total_count > 0 ? static_cast<double>(value_sum) / total_count : 0; }
+};
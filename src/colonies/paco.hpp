@@ -0,0 +1,191 @@
+#pragma once
+
+#include <cmath>
+#include <deque>
+
+#include "base.hpp"
+
+/*
+	Population-based ACO
+
+	Pheromone is not evaporated. Instead every edge holds a base value (min_pheromone)
+	plus a fixed share for every route of the population that uses it:
+
+		tau = tau_min + count * (tau_max - tau_min) / k
+
+	The population is a FIFO of the last k iteration-best routes.
+	Entering and leaving routes only touch their own n edges instead of all edges.
+
+	Arguments: paco:<k>
+		k : Size of the population. Default: 5
+*/
+class PacoAntOptimizer: public AntOptimizer {
+private:
+	std::deque<Route> population;
+	size_t population_size = 5;
+	float delta = 0;
+
+	/*
+		Routes of the population that use each edge, indexed by `edge_id`.
+		The trail is recomputed from the count, adding and subtracting `delta` would let rounding errors pile up.
+	*/
+	std::vector<int32_t> usage;
+
+	void save_state(BinaryWriter& out) const override {
+		out.put<uint64_t>(population.size());
+		for (const Route& route : population) {
+			out.put(route.nodes);
+			out.put<int32_t>(route.length);
+		}
+	}
+
+	bool load_state(BinaryReader& in) override {
+		uint64_t size;
+		if (!in.get(size)) { return false; }
+
+		population.clear();
+		std::fill(usage.begin(), usage.end(), 0);
+		for (uint64_t i = 0; i < size; i++) {
+			Route route;
+			int32_t length;
+			if (!in.get(route.nodes) || !in.get(length)) { return false; }
+			route.length = length;
+			population.push_back(std::move(route));
+			apply_route(population.back(), 1);
+		}
+		return true;
+	}
+
+	// `change` is +1 for a route entering the population and -1 for one leaving it
+	void apply_route(const Route& route, int32_t change) {
+		for (auto it = std::next(route.nodes.begin()); it != route.nodes.end(); it++) {
+			const size_t edge = edge_id(*std::prev(it), *it);
+			if (edge == NO_EDGE_ID) { continue; }
+			usage[edge] += change;
+			edge_pheromone[edge] = params.min_pheromone + usage[edge] * delta;
+		}
+	}
+public:
+	using AntOptimizer::AntOptimizer;
+
+	static constexpr const char* _name = "paco";
+	std::string name() override { return _name; }
+
+	void memory_usage(MemoryReport& report) const override {
+		AntOptimizer::memory_usage(report);
+		size_t bytes = population.size() * sizeof(Route);
+		for (const Route& route : population) {
+			bytes += vector_bytes(route.nodes);
+		}
+		report.add("population", bytes);
+		report.add("usage", vector_bytes(usage));
+	}
+
+	void init(std::string args) override {
+		if (!args.empty()) {
+			population_size = std::max(1, std::stoi(args));
+		}
+
+		delta = (params.max_pheromone - params.min_pheromone) / population_size;
+		usage.assign(edge_pheromone.size(), 0);
+		for_all_edges([&](graph::Node, graph::Node, size_t edge) {
+			edge_pheromone[edge] = params.min_pheromone;
+		});
+	}
+
+	/*
+		The tour takes round(strength * k) places of the population, all of them at strength 1
+	*/
+	void warm_start(const Route& route, float strength) override {
+		update_best_route(route);
+		strength = std::clamp(strength, 0.0f, 1.0f);
+		if (route.length < 0) { return; }
+
+		const size_t copies = std::lround(strength * population_size);
+		for (size_t i = 0; i < copies && population.size() < population_size; i++) {
+			population.push_back(route);
+			apply_route(route, 1);
+		}
+	}
+
+	void optimize() override {
+		// Init Ants
+		std::vector<Ant> ants;
+		{
+			ScopedPhase phase(phase_times, Phase::reset);
+			ants = initial_ants;
+			for (Ant& ant : ants) {
+				ant.generator.seed(seed_generator());
+			}
+		}
+		const Ant* best_ant = nullptr;
+
+		for (Ant& ant : ants) {
+			if (cancelled()) { break; }
+
+			{
+				ScopedPhase phase(phase_times, Phase::construction);
+				for (int i = 0; i < graph.node_count() - 1; i++) {
+					advance_ant(ant);
+					if (ant.current_node == graph::NO_NODE) { break; }
+				}
+			}
+
+			if (!goal_reached(ant)) {
+				// Invalid solution
+				continue;
+			}
+
+			ScopedPhase phase(phase_times, Phase::evaluation);
+			ant.route.length = route_length(ant.route.nodes);
+		}
+
+		if (abandon_round()) { return; }
+
+		{
+			ScopedPhase phase(phase_times, Phase::reduction);
+			record_round(ants);
+			for (const Ant& ant : ants) {
+				if (ant.route.length == -1) { continue; }
+				update_best_route(ant);
+
+				if (best_ant == nullptr || ant.route.length < best_ant->route.length) {
+					best_ant = &ant;
+				}
+			}
+		}
+
+		if (best_ant == nullptr) return;
+
+		ScopedPhase phase(phase_times, Phase::update);
+
+		// O(n) update: iteration best enters, oldest route leaves
+		population.push_back(best_ant->route);
+		apply_route(population.back(), 1);
+
+		if (population.size() > population_size) {
+			apply_route(population.front(), -1);
+			population.pop_front();
+		}
+
+		round++;
+	}
+
+	Profiler optimize(int rounds) override {
+		Profiler pf;
+		phase_times.clear();
+		phase_times.trace = trace_thread("main");
+		PerfCounters counters(perf_counters);
+
+		while (rounds-- > 0 && !stop_requested()) {
+			pf.start();
+			optimize();
+			if (round_abandoned) { break; }
+			finish_round(pf);
+		}
+
+		pf.phases.push_back(phase_times);
+		if (perf_counters) { pf.counters.push_back(counters.read()); }
+		return pf;
+	}
+};
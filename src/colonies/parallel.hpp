@@ -3,33 +3,46 @@
 #include "base.hpp"
 #include <pthread.h>
 #include <iostream>
+#include <system_error>
+#include <thread>
 
 class ParallelAntOptimizer: public AntOptimizer {
 private:
 	struct ThreadArgs {
 		Ant& ant;
 		const ParallelAntOptimizer& optimizer;
+		PhaseTimes phases = {};
+		CounterValues counters = {};
 
 		ThreadArgs(Ant& a, const ParallelAntOptimizer& o) : ant(a), optimizer(o) {}
 	};
 
 	static void* optimize_threaded(void* __args) {
 		ThreadArgs* args = static_cast<ThreadArgs*>(__args);
+		PerfCounters counters(args->optimizer.perf_counters);
+		if (args->optimizer.cancelled()) { return nullptr; }
 
 		// Let ants wander (96% of the loop body happens here)
-		for (int i = 0; i < args->optimizer.graph.node_count() - 1; i++) {
-			args->optimizer.advance_ant(args->ant);
-			if (args->ant.current_node == graph::NO_NODE) { break; }
+		{
+			ScopedPhase phase(args->phases, Phase::construction);
+			for (int i = 0; i < args->optimizer.graph.node_count() - 1; i++) {
+				args->optimizer.advance_ant(args->ant);
+				if (args->ant.current_node == graph::NO_NODE) { break; }
+			}
 		}
 
-		if (!args->optimizer.goal_reached(args->ant)) {
-			// Invalid solution
-			return nullptr;
+		if (args->optimizer.goal_reached(args->ant)) {
+			ScopedPhase phase(args->phases, Phase::evaluation);
+			args->ant.route.length = args->optimizer.route_length(args->ant.route.nodes);
 		}
 
-		args->ant.route.length = args->optimizer.route_length(args->ant.route.nodes);
+		args->counters = counters.read();
 		return nullptr;
 	}
+
+	// Phase times and counters of all (short lived) ant threads combined
+	PhaseTimes worker_phases;
+	CounterValues worker_counters;
 public:
 	using AntOptimizer::AntOptimizer;
 
@@ -38,75 +51,89 @@ public:
 
 	void optimize() override {
 		// Init Ants
-		std::vector<Ant> ants = initial_ants;
-		const Ant* best_ant = nullptr;
+		std::vector<Ant> ants;
+		{
+			ScopedPhase phase(phase_times, Phase::reset);
+			ants = initial_ants;
+			for (Ant& ant : ants) {
+				ant.generator.seed(seed_generator());
+			}
+		}
 		
 		std::vector<pthread_t> threads;
 		threads.reserve(ants.size());
 		std::vector<ThreadArgs> thread_args;
 		thread_args.reserve(ants.size());
 
-		for (Ant& ant : ants) {
-			ant.generator.seed(rand_device());
-
-			thread_args.emplace_back(ant, *this);
-			threads.emplace_back(static_cast<pthread_t>(0));
-			int succ = pthread_create(&threads.back(), nullptr, optimize_threaded, static_cast<void*>(&thread_args.back()));
-			if (succ != 0) {
-				std::cout << "pthread_create returned " << succ << std::endl;
-				exit(1);
-			}
-		}
-
-		for (size_t i = 0; i < threads.size(); i++) {
-			int succ = pthread_join(threads.at(i), nullptr);
-			if (succ != 0) {
-				std::cout << "pthread_join returned " << succ << std::endl;
-				exit(1);
+		{
+			// Thread creation and joining is what the other colonies spend at their barriers
+			ScopedPhase phase(phase_times, Phase::barrier);
+
+			for (Ant& ant : ants) {
+				thread_args.emplace_back(ant, *this);
+				threads.emplace_back(static_cast<pthread_t>(0));
+				int succ = pthread_create(&threads.back(), nullptr, optimize_threaded, static_cast<void*>(&thread_args.back()));
+				if (succ != 0) {
+					// The ants started so far walk on `ants`
+					threads.pop_back();
+					for (const auto& thread : threads) { pthread_join(thread, nullptr); }
+					throw std::system_error(succ, std::generic_category(), "pthread_create");
+				}
 			}
 
-			const Ant& ant = ants.at(i);
-			if (ant.route.length == -1) {
-				// Indicator for invalid solution
-				continue;
-			}
-			update_best_route(ant);
-
-			if (best_ant == nullptr || ant.route.length < best_ant->route.length) {
-				best_ant = &ant;
+			for (const auto& thread : threads) {
+				int succ = pthread_join(thread, nullptr);
+				if (succ != 0) {
+					throw std::system_error(succ, std::generic_category(), "pthread_join");
+				}
 			}
 		}
 
-
-		/*
-			We don't need to initialize this.
-			We call the `[]`-operator, which creates entries with the default initializer
-			The default initializer for float returns 0.0, which is what we would initialize this to.
-		*/
-		std::map<graph::Edge, float> delta_pheromone;
-
-		if (best_ant == nullptr) return;
-		for (auto it = std::next(best_ant->route.nodes.begin()); it != best_ant->route.nodes.end(); it++) {
-			graph::Edge edge(*std::prev(it), *it);
-			delta_pheromone[edge] += pheromone_update(*best_ant, edge);
+		if (abandon_round()) { return; }
+
+		{
+			ScopedPhase phase(phase_times, Phase::reduction);
+			record_round(ants);
+			for (size_t i = 0; i < threads.size(); i++) {
+				worker_phases += thread_args.at(i).phases;
+				worker_counters += thread_args.at(i).counters;
+
+				const Ant& ant = ants.at(i);
+				if (ant.route.length == -1) {
+					// Indicator for invalid solution
+					continue;
+				}
+				update_best_route(ant);
+			}
 		}
 
-		for (auto& edge_pair : edge_pheromone) {
-			update_edge_pheromone(edge_pair.second, delta_pheromone.count(edge_pair.first) > 0 ? delta_pheromone.at(edge_pair.first) : 0);
-		}
+		ScopedPhase phase(phase_times, Phase::update);
+		if (!update_pheromone(ants)) return;
 		
 		round++;
 	}
 
 	Profiler optimize(int rounds) override {
 		Profiler pf;
+		phase_times.clear();
+		phase_times.trace = trace_thread("main");
+		worker_phases.clear();
+		worker_counters = CounterValues();
+		PerfCounters counters(perf_counters);
 	
-		while (rounds-- > 0) {
+		while (rounds-- > 0 && !stop_requested()) {
 			pf.start();
 			optimize();
-			pf.stop();
+			if (round_abandoned) { break; }
+			finish_round(pf);
 		}
 
+		pf.phases.push_back(phase_times);
+		pf.phases.push_back(worker_phases);
+		if (perf_counters) {
+			pf.counters.push_back(counters.read());
+			pf.counters.push_back(worker_counters);
+		}
 		return pf;
 	}
 };
@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/*
+	Parts of an optimization round that are timed separately
+*/
+enum class Phase {
+	reset,        // Copying and seeding the ants
+	construction, // Ants walking
+	evaluation,   // Calculating route lengths
+	reduction,    // Finding the best route(s)
+	update,       // Pheromone evaporation and deposit
+	barrier,      // Waiting for / starting other threads
+	count
+};
+
+inline const char* phase_name(Phase phase) {
+	switch (phase) {
+		case Phase::reset:        return "reset";
+		case Phase::construction: return "construction";
+		case Phase::evaluation:   return "evaluation";
+		case Phase::reduction:    return "reduction";
+		case Phase::update:       return "update";
+		case Phase::barrier:      return "barrier";
+		default:                  return "unknown";
+	}
+}
+
+/*
+	Cheapest available timestamp. Uses the time stamp counter where possible,
+	`ticks_per_second` converts it to wall time.
+*/
+inline uint64_t read_ticks() {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#elif defined(__aarch64__)
+	uint64_t ticks;
+	asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+	return ticks;
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/*
+	Measured once against std::chrono::steady_clock (takes ~10ms on first call)
+*/
+inline double ticks_per_second() {
+	static const double frequency = []() {
+		using Clock = std::chrono::steady_clock;
+		auto t1 = Clock::now();
+		uint64_t c1 = read_ticks();
+		while (Clock::now() - t1 < std::chrono::milliseconds(10)) {}
+		uint64_t c2 = read_ticks();
+		auto t2 = Clock::now();
+		return (c2 - c1) / std::chrono::duration<double>(t2 - t1).count();
+	}();
+	return frequency;
+}
+
+struct TraceEvent {
+	Phase phase;
+	uint64_t start;
+	uint64_t end;
+};
+
+/*
+	Ring of the last `capacity` phases of one thread, older events are overwritten.
+	Only the owning thread writes, it is read after the thread finished.
+*/
+class TraceBuffer {
+private:
+	std::vector<TraceEvent> events;
+	uint64_t total = 0;
+public:
+	explicit TraceBuffer(size_t capacity) : events(std::max<size_t>(1, capacity)) {}
+
+	void push(const TraceEvent& event) {
+		events[total % events.size()] = event;
+		total++;
+	}
+
+	// Oldest to newest
+	template <typename F>
+	void for_each(F f) const {
+		uint64_t first = total > events.size() ? total - events.size() : 0;
+		for (uint64_t i = first; i < total; i++) {
+			f(events[i % events.size()]);
+		}
+	}
+
+	uint64_t overwritten() const {
+		return total > events.size() ? total - events.size() : 0;
+	}
+};
+
+/*
+	Accumulated ticks per phase of one thread.
+	Every thread owns its own instance, so recording needs no synchronisation.
+*/
+struct PhaseTimes {
+	std::array<uint64_t, static_cast<size_t>(Phase::count)> ticks{};
+	// Every phase is also recorded here if set, see TraceRecorder
+	TraceBuffer* trace = nullptr;
+
+	void add(Phase phase, uint64_t t) {
+		ticks[static_cast<size_t>(phase)] += t;
+	}
+
+	uint64_t get(Phase phase) const {
+		return ticks[static_cast<size_t>(phase)];
+	}
+
+	double micros(Phase phase) const {
+		return get(phase) * 1e6 / ticks_per_second();
+	}
+
+	PhaseTimes& operator+=(const PhaseTimes& other) {
+		for (size_t i = 0; i < ticks.size(); i++) {
+			ticks[i] += other.ticks[i];
+		}
+		return *this;
+	}
+
+	void clear() {
+		ticks.fill(0);
+	}
+};
+
+/*
+	Adds the lifetime of this object to `phase`
+*/
+struct ScopedPhase {
+	PhaseTimes& times;
+	Phase phase;
+	uint64_t start;
+
+	ScopedPhase(PhaseTimes& times, Phase phase) : times(times), phase(phase), start(read_ticks()) {}
+	~ScopedPhase() {
+		uint64_t end = read_ticks();
+		times.add(phase, end - start);
+		if (times.trace != nullptr) {
+			times.trace->push(TraceEvent{ phase, start, end });
+		}
+	}
+
+	ScopedPhase(const ScopedPhase&) = delete;
+	ScopedPhase& operator=(const ScopedPhase&) = delete;
+};
@@ -0,0 +1,56 @@
+#include <algorithm>
+#include <iostream>
+
+#include "registry.hpp"
+
+#include "serial.hpp"
+#include "parallel.hpp"
+#include "batched.hpp"
+#include "threaded.hpp"
+#include "acs.hpp"
+#include "paco.hpp"
+
+template<typename Ty>
+struct ColonyFactory: AbstractColonyFactory {
+	std::string name() const override { return Ty::_name; }
+
+	std::unique_ptr<AntOptimizer> make(const Problem& problem, const std::vector<Ant>& ants, Parameters params, std::string args) override {
+		auto e = std::make_unique<Ty>(problem.graph, problem.instance, ants, params);
+		e->init_args = args;
+		e->init(args);
+		return e;
+	}
+};
+
+std::vector<std::unique_ptr<AbstractColonyFactory>> colonies;
+void init_colonies() {
+	#define add(CLASS) do { colonies.emplace_back(std::make_unique<ColonyFactory<CLASS>>()); } while(0)
+
+	add(SerialAntOptimizer);
+	add(ParallelAntOptimizer);
+	add(BatchedAntOptimizer);
+	add(ThreadedAntOptimizer);
+	add(AcsAntOptimizer);
+	add(PacoAntOptimizer);
+
+	#undef add
+}
+
+std::unique_ptr<AntOptimizer> makeColony(const std::string& colony_constructor, const Problem& problem, const std::vector<Ant>& ants, Parameters params) {
+	auto sep = colony_constructor.find_first_of(":");
+	const std::string identifier = colony_constructor.substr(0, sep);
+	const std::string args = (sep != std::string::npos ? colony_constructor.substr(sep + 1) : "");
+
+	auto it = std::find_if(colonies.begin(), colonies.end(), [&](const std::unique_ptr<AbstractColonyFactory>& e){ return e->name() == identifier; });
+
+	if (it == colonies.end()) {
+		std::cout << "Unknown colony: " << identifier << std::endl;
+		exit(1);
+	}
+
+	return (*it)->make(problem, ants, params, args);
+}
+
+std::vector<std::string> all_colony_options() {
+	return { "serial", "parallel", "batched:1", "batched:15", "threaded:auto", "threaded:4" };
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "base.hpp"
+#include "../problem.hpp"
+
+struct AbstractColonyFactory {
+	virtual std::string name() const = 0;
+	virtual std::unique_ptr<AntOptimizer> make(const Problem& problem, const std::vector<Ant>& ants, Parameters params, std::string args) = 0;
+	virtual ~AbstractColonyFactory() = default;
+};
+
+extern std::vector<std::unique_ptr<AbstractColonyFactory>> colonies;
+
+void init_colonies();
+
+/*
+	Creates a colony from `<name>[:<args>]`, e.g. `threaded:4`
+	Exits if there is no colony called `name`
+*/
+std::unique_ptr<AntOptimizer> makeColony(const std::string& colony_constructor, const Problem& problem, const std::vector<Ant>& ants, Parameters params);
+
+// Colony specs run by `-t all`
+std::vector<std::string> all_colony_options();
@@ -14,18 +14,26 @@ public:
 	*/
 	void optimize() override {
 		// Init Ants
-		std::vector<Ant> ants = initial_ants;
-		const Ant* best_ant = nullptr;
-		
+		std::vector<Ant> ants;
+		{
+			ScopedPhase phase(phase_times, Phase::reset);
+			ants = initial_ants;
+			for (Ant& ant : ants) {
+				ant.generator.seed(seed_generator());
+			}
+		}
 
 		// 97% of function time is spent in this loop
 		for (Ant& ant : ants) {
-			ant.generator.seed(rand_device());
-			
+			if (cancelled()) { break; }
+
 			// Let ants wander (96% of the loop body happens here)
-			for (int i = 0; i < graph.node_count() - 1; i++) {
-				advance_ant(ant);
-				if (ant.current_node == graph::NO_NODE) { break; }
+			{
+				ScopedPhase phase(phase_times, Phase::construction);
+				for (int i = 0; i < graph.node_count() - 1; i++) {
+					advance_ant(ant);
+					if (ant.current_node == graph::NO_NODE) { break; }
+				}
 			}
 
 			if (!goal_reached(ant)) {
@@ -33,43 +41,41 @@ public:
 				continue;
 			}
 
+			ScopedPhase phase(phase_times, Phase::evaluation);
 			ant.route.length = route_length(ant.route.nodes);
-			update_best_route(ant);
-
-			if (best_ant == nullptr || ant.route.length < best_ant->route.length) {
-				best_ant = &ant;
-			}
 		}
 
-		/*
-			We don't need to initialize this.
-			We call the `[]`-operator, which creates entries with the default initializer
-			The default initializer for float returns 0.0, which is what we would initialize this to.
-		*/
-		std::map<graph::Edge, float> delta_pheromone;
+		if (abandon_round()) { return; }
 
-		if (best_ant == nullptr) return;
-		for (auto it = std::next(best_ant->route.nodes.begin()); it != best_ant->route.nodes.end(); it++) {
-			graph::Edge edge(*std::prev(it), *it);
-			delta_pheromone[edge] += pheromone_update(*best_ant, edge);
+		{
+			ScopedPhase phase(phase_times, Phase::reduction);
+			record_round(ants);
+			for (const Ant& ant : ants) {
+				update_best_route(ant);
+			}
 		}
 
-		for (auto& edge_pair : edge_pheromone) {
-			update_edge_pheromone(edge_pair.second, delta_pheromone.count(edge_pair.first) > 0 ? delta_pheromone.at(edge_pair.first) : 0);
-		}
+		ScopedPhase phase(phase_times, Phase::update);
+		if (!update_pheromone(ants)) return;
 		
 		round++;
 	}
 
 	Profiler optimize(int rounds) override {
 		Profiler pf;
+		phase_times.clear();
+		phase_times.trace = trace_thread("main");
+		PerfCounters counters(perf_counters);
 		
-		while (rounds-- > 0) {
+		while (rounds-- > 0 && !stop_requested()) {
 			pf.start();
 			optimize();
-			pf.stop();
+			if (round_abandoned) { break; }
+			finish_round(pf);
 		}
 
+		pf.phases.push_back(phase_times);
+		if (perf_counters) { pf.counters.push_back(counters.read()); }
 		return pf;	
 	}
 };
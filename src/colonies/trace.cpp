@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <fstream>
+
+#include "trace.hpp"
+
+namespace {
+	std::string json_string(const std::string& str) {
+		std::string result = "\"";
+		for (char c : str) {
+			if (c == '"' || c == '\\') { result += '\\'; }
+			result += c;
+		}
+		return result + "\"";
+	}
+}
+
+TraceRecorder::TraceRecorder(size_t capacity_per_thread) : capacity(capacity_per_thread), start_ticks(read_ticks()) {
+	// Calibrate now instead of in the middle of the first traced round
+	ticks_per_second();
+}
+
+TraceBuffer* TraceRecorder::add_thread(const std::string& process, const std::string& name) {
+	auto it = std::find(processes.begin(), processes.end(), process);
+	int pid = std::distance(processes.begin(), it) + 1;
+	if (it == processes.end()) {
+		processes.push_back(process);
+	}
+
+	int tid = std::count_if(threads.begin(), threads.end(), [pid](const Thread& t) { return t.pid == pid; });
+	threads.push_back(Thread{ pid, tid, name, TraceBuffer(capacity) });
+	return &threads.back().buffer;
+}
+
+void TraceRecorder::write(const std::filesystem::path& path) const {
+	std::ofstream file(path);
+	const double us_per_tick = 1e6 / ticks_per_second();
+	file.precision(3);
+	file << std::fixed;
+
+	file << "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n";
+	bool first = true;
+	auto separator = [&]() {
+		file << (first ? "" : ",\n");
+		first = false;
+	};
+
+	for (size_t i = 0; i < processes.size(); i++) {
+		separator();
+		file << "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": " << i + 1 << ", \"args\": {\"name\": " << json_string(processes[i]) << "}}";
+	}
+
+	for (const auto& thread : threads) {
+		separator();
+		file
+			<< "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": " << thread.pid << ", \"tid\": " << thread.tid
+			<< ", \"args\": {\"name\": " << json_string(thread.name) << "}}";
+
+		if (thread.buffer.overwritten() > 0) {
+			separator();
+			file
+				<< "{\"name\": \"dropped_events\", \"ph\": \"C\", \"pid\": " << thread.pid << ", \"tid\": " << thread.tid
+				<< ", \"ts\": 0, \"args\": {\"overwritten\": " << thread.buffer.overwritten() << "}}";
+		}
+
+		thread.buffer.for_each([&](const TraceEvent& event) {
+			separator();
+			file
+				<< "{\"name\": \"" << phase_name(event.phase) << "\", \"ph\": \"X\""
+				<< ", \"pid\": " << thread.pid << ", \"tid\": " << thread.tid
+				<< ", \"ts\": " << (static_cast<double>(event.start) - start_ticks) * us_per_tick
+				<< ", \"dur\": " << static_cast<double>(event.end - event.start) * us_per_tick << "}";
+		});
+	}
+
+	file << "\n]}\n";
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+
+#include "phases.hpp"
+
+/*
+	Timeline of all phases of all threads, exported in the Chrome trace event format
+	(chrome://tracing, ui.perfetto.dev).
+
+	Every thread gets its own TraceBuffer, so recording never synchronises.
+	`add_thread` is not thread safe: call it before the thread starts and
+	`write` only after all recorded threads have finished.
+*/
+class TraceRecorder {
+private:
+	struct Thread {
+		int pid;
+		int tid;
+		std::string name;
+		TraceBuffer buffer;
+	};
+
+	// Deque keeps buffer addresses stable while threads are added
+	std::deque<Thread> threads;
+	std::deque<std::string> processes;
+	size_t capacity;
+	uint64_t start_ticks;
+public:
+	explicit TraceRecorder(size_t capacity_per_thread = 1 << 16);
+
+	/*
+		Returns the buffer for a new thread `name`, grouped by `process` (e.g. the colony)
+	*/
+	TraceBuffer* add_thread(const std::string& process, const std::string& name);
+
+	void write(const std::filesystem::path& path) const;
+};
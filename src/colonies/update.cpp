@@ -0,0 +1,63 @@
+#include <stdexcept>
+
+#include "update.hpp"
+#include "base.hpp"
+
+void IterationBestUpdate::select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const {
+	deposits.push_back(Deposit{ ranked.front(), 1 });
+}
+
+void GlobalBestUpdate::select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const {
+	deposits.push_back(Deposit{ &best_route, 1 });
+}
+
+void ScheduleUpdate::select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const {
+	int frequency = 0;
+	if      (round <  25 * scale) { frequency = 0; }
+	else if (round <  75 * scale) { frequency = 5; }
+	else if (round < 125 * scale) { frequency = 3; }
+	else if (round < 250 * scale) { frequency = 2; }
+	else                          { frequency = 1; }
+
+	bool use_global = frequency != 0 && round % frequency == 0;
+	deposits.push_back(Deposit{ use_global ? &best_route : ranked.front(), 1 });
+}
+
+void RankUpdate::select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const {
+	int count = std::min(static_cast<int>(ranked.size()), w - 1);
+	for (int r = 0; r < count; r++) {
+		deposits.push_back(Deposit{ ranked[r], static_cast<float>(w - (r + 1)) });
+	}
+	deposits.push_back(Deposit{ &best_route, static_cast<float>(w) });
+}
+
+void ElitistUpdate::select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const {
+	for (const Route* route : ranked) {
+		deposits.push_back(Deposit{ route, 1 });
+	}
+	deposits.push_back(Deposit{ &best_route, e });
+}
+
+std::shared_ptr<UpdateStrategy> make_update_strategy(const std::string& identifier) {
+	auto sep = identifier.find_first_of(":");
+	const std::string name = identifier.substr(0, sep);
+	const std::string args = (sep != std::string::npos ? identifier.substr(sep + 1) : "");
+
+	// std::stoi and std::stof throw on `rank:x`, callers treat it like an unknown name
+	try {
+		if (name == "iteration-best") { return std::make_shared<IterationBestUpdate>(); }
+		if (name == "global-best")    { return std::make_shared<GlobalBestUpdate>(); }
+		if (name == "schedule")       { return std::make_shared<ScheduleUpdate>(args.empty() ? 1 : std::stof(args)); }
+		if (name == "rank")           { return std::make_shared<RankUpdate>(args.empty() ? 6 : std::max(1, std::stoi(args))); }
+		if (name == "elitist")        { return std::make_shared<ElitistUpdate>(args.empty() ? 1 : std::stof(args)); }
+	}
+	catch (const std::logic_error&) {
+		return nullptr;
+	}
+
+	return nullptr;
+}
+
+std::vector<std::string> update_strategy_names() {
+	return { "iteration-best", "global-best", "schedule[:scale]", "rank[:w]", "elitist[:e]" };
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Route;
+
+/*
+	A route chosen to deposit pheromone after a round.
+	The deposit on every edge of `route` is `weight * q / L`.
+*/
+struct Deposit {
+	const Route* route;
+	float weight;
+};
+
+/*
+	Decides which routes deposit pheromone after a round.
+	Evaporation and the actual deposit are done by `AntOptimizer::update_pheromone`.
+
+	Strategies are stateless so one instance can be shared between colonies.
+*/
+class UpdateStrategy {
+public:
+	virtual ~UpdateStrategy() = default;
+
+	/*
+		`ranked` holds the routes of all ants that reached the goal this round,
+		shortest first. It is never empty.
+		`best_route` is the best route so far (already including this round).
+	*/
+	virtual void select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const = 0;
+
+	virtual std::string name() const = 0;
+};
+
+// Only the best ant of the round deposits (default)
+class IterationBestUpdate: public UpdateStrategy {
+public:
+	void select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const override;
+	std::string name() const override { return "iteration-best"; }
+};
+
+// Only the best route so far deposits
+class GlobalBestUpdate: public UpdateStrategy {
+public:
+	void select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const override;
+	std::string name() const override { return "global-best"; }
+};
+
+/*
+	Iteration best, but every f-th round the best route so far deposits instead.
+	f shrinks over time as proposed for MMAS by Stützle and Hoos:
+		round < 25: never, < 75: 5, < 125: 3, < 250: 2, afterwards: always
+	`scale` stretches the schedule for longer runs.
+*/
+class ScheduleUpdate: public UpdateStrategy {
+private:
+	float scale;
+public:
+	ScheduleUpdate(float scale = 1) : scale(scale) {}
+	void select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const override;
+	std::string name() const override { return "schedule"; }
+};
+
+/*
+	Rank-based Ant System: The w - 1 best ants of the round deposit with weight w - r,
+	the best route so far with weight w.
+*/
+class RankUpdate: public UpdateStrategy {
+private:
+	int w;
+public:
+	RankUpdate(int w = 6) : w(w) {}
+	void select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const override;
+	std::string name() const override { return "rank"; }
+};
+
+/*
+	Elitist Ant System: All ants deposit, the best route so far
+	deposits an additional `e` times.
+*/
+class ElitistUpdate: public UpdateStrategy {
+private:
+	float e;
+public:
+	ElitistUpdate(float e = 1) : e(e) {}
+	void select(const std::vector<const Route*>& ranked, const Route& best_route, int round, std::vector<Deposit>& deposits) const override;
+	std::string name() const override { return "elitist"; }
+};
+
+/*
+	Creates an update strategy from `<name>[:<arg>]`, e.g. `rank:6`
+	Returns nullptr for unknown names and arguments that are no number.
+*/
+std::shared_ptr<UpdateStrategy> make_update_strategy(const std::string& identifier);
+
+// Names accepted by `make_update_strategy`
+std::vector<std::string> update_strategy_names();
@@ -0,0 +1,531 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon.hpp"
+#include "batch.hpp"
+#include "problem_cache.hpp"
+#include "colonies/registry.hpp"
+
+namespace {
+	// How often blocked reads and accepts look for SIGTERM
+	constexpr int poll_interval_ms = 200;
+	// Largest inline instance accepted, a dense 10k node matrix is about 500 MiB of text
+	constexpr size_t max_instance_bytes = size_t(1) << 30;
+
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsed_ms(Clock::time_point since) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+	/*
+		Buffered line reader and writer on a socket. Reads give up once the daemon is terminated.
+	*/
+	class Connection {
+	private:
+		int fd;
+		std::string buffer;
+		size_t position = 0;
+
+		// Appends what arrived to `buffer`, false on end of stream or termination
+		bool fill() {
+			if (position > 0) {
+				buffer.erase(0, position);
+				position = 0;
+			}
+
+			pollfd waiting{ fd, POLLIN, 0 };
+			while (true) {
+				if (termination_requested()) { return false; }
+				const int ready = poll(&waiting, 1, poll_interval_ms);
+				if (ready > 0) { break; }
+				if (ready < 0 && errno != EINTR) { return false; }
+			}
+
+			char chunk[1 << 16];
+			const ssize_t count = recv(fd, chunk, sizeof(chunk), 0);
+			if (count <= 0) { return false; }
+			buffer.append(chunk, count);
+			return true;
+		}
+	public:
+		explicit Connection(int fd) : fd(fd) {}
+		~Connection() { close(fd); }
+
+		int descriptor() const { return fd; }
+		// True if data that was read already has not been consumed
+		bool buffered() const { return position < buffer.size(); }
+
+		Connection(const Connection&) = delete;
+		Connection& operator=(const Connection&) = delete;
+
+		// Next line without its line break, false at the end of the stream
+		bool read_line(std::string& line) {
+			size_t end;
+			while ((end = buffer.find('\n', position)) == std::string::npos) {
+				if (!fill()) { return false; }
+			}
+			line = buffer.substr(position, end - position);
+			if (!line.empty() && line.back() == '\r') { line.pop_back(); }
+			position = end + 1;
+			return true;
+		}
+
+		bool read_bytes(size_t count, std::string& bytes) {
+			while (buffer.size() - position < count) {
+				if (!fill()) { return false; }
+			}
+			bytes = buffer.substr(position, count);
+			position += count;
+			return true;
+		}
+
+		// False once the client is gone
+		bool write(const std::string& text) {
+			for (size_t sent = 0; sent < text.size();) {
+				const ssize_t count = send(fd, text.data() + sent, text.size() - sent, MSG_NOSIGNAL);
+				if (count < 0 && errno == EINTR) { continue; }
+				if (count <= 0) { return false; }
+				sent += count;
+			}
+			return true;
+		}
+	};
+
+	/*
+		Parsed instances with their ants, initial route and parameters.
+		Keyed by hash and length of the instance text, so a file and the same text sent inline share an entry.
+	*/
+	class InstanceCache {
+	private:
+		typedef std::pair<uint64_t, size_t> Key;
+		struct Entry {
+			std::shared_ptr<LoadedProblem> loaded;
+			uint64_t last_used;
+		};
+
+		std::mutex mutex;
+		std::map<Key, Entry> entries;
+		uint64_t clock = 0;
+		size_t capacity;
+	public:
+		explicit InstanceCache(size_t capacity) : capacity(std::max<size_t>(1, capacity)) {}
+
+		std::shared_ptr<LoadedProblem> find(const Key& key) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = entries.find(key);
+			if (it == entries.end()) { return nullptr; }
+			it->second.last_used = clock++;
+			return it->second.loaded;
+		}
+
+		/*
+			Keeps `loaded` unless another request was faster, returns the entry to use.
+			Running solves keep evicted instances alive until they finish.
+		*/
+		std::shared_ptr<LoadedProblem> insert(const Key& key, std::shared_ptr<LoadedProblem> loaded) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = entries.find(key);
+			if (it != entries.end()) {
+				it->second.last_used = clock++;
+				return it->second.loaded;
+			}
+
+			if (entries.size() >= capacity) {
+				auto oldest = std::min_element(entries.begin(), entries.end(), [](const auto& a, const auto& b) {
+					return a.second.last_used < b.second.last_used;
+				});
+				entries.erase(oldest);
+			}
+			entries.emplace(key, Entry{ loaded, clock++ });
+			return loaded;
+		}
+	};
+
+	struct Request {
+		std::string source;
+		std::string content;
+		std::string colony = "serial";
+		std::string update = "iteration-best";
+		int rounds = 100;
+		double seconds = 0;
+		bool seeded = false;
+		unsigned int seed = 0;
+		// First problem found while reading the request, reported instead of solving
+		std::string error;
+	};
+
+	class Daemon {
+	private:
+		const DaemonConfig& config;
+		SlotPool slots;
+		InstanceCache cache;
+		std::mutex print_mutex;
+		// Colonies running for a connection, by its descriptor
+		std::mutex solving_mutex;
+		std::map<int, AntOptimizer*> solving;
+
+		void reply_error(Connection& connection, const std::string& message) {
+			connection.write("error " + message + "\n");
+		}
+
+		/*
+			Reads lines up to `solve`, false if the connection ended first
+		*/
+		bool read_request(Connection& connection, Request& request) {
+			auto fail = [&request](const std::string& message) {
+				if (request.error.empty()) { request.error = message; }
+			};
+
+			for (std::string line; connection.read_line(line);) {
+				if (line.empty()) { continue; }
+				if (line == "solve") { return true; }
+
+				const auto space = line.find(' ');
+				const auto first = space != std::string::npos ? line.find_first_not_of(' ', space) : std::string::npos;
+				const std::string key = line.substr(0, space);
+				const std::string value = first != std::string::npos ? line.substr(first) : "";
+
+				try {
+					if (key == "path") {
+						std::ifstream file(value, std::ios::binary);
+						if (!file.is_open()) {
+							fail("Could not open " + value);
+							continue;
+						}
+						request.source = value;
+						request.content.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+					}
+					else if (key == "instance") {
+						const long long size = std::stoll(value);
+						if (size <= 0 || static_cast<size_t>(size) > max_instance_bytes) {
+							// The bytes can not be skipped reliably, give up on the connection
+							reply_error(connection, "Instance size out of range: " + value);
+							return false;
+						}
+						request.source = "inline instance";
+						if (!connection.read_bytes(size, request.content)) { return false; }
+					}
+					else if (key == "colony") { request.colony = value; }
+					else if (key == "update") { request.update = value; }
+					else if (key == "rounds") { request.rounds = std::max(0, std::stoi(value)); }
+					else if (key == "seconds") { request.seconds = std::stod(value); }
+					else if (key == "seed") {
+						request.seed = std::stoul(value);
+						request.seeded = true;
+					}
+					else {
+						fail("Unknown key: " + key);
+					}
+				}
+				catch (const std::exception&) {
+					if (key == "instance") {
+						reply_error(connection, "Instance size out of range: " + value);
+						return false;
+					}
+					fail("Invalid value for " + key + ": " + value);
+				}
+			}
+			return false;
+		}
+
+		std::shared_ptr<LoadedProblem> load(Connection& connection, const Request& request) {
+			const std::pair<uint64_t, size_t> key(checksum(request.content.data(), request.content.size()), request.content.size());
+			std::ostringstream hash;
+			hash << std::hex << std::setw(16) << std::setfill('0') << key.first;
+
+			std::shared_ptr<LoadedProblem> loaded = cache.find(key);
+			const bool cached = loaded != nullptr;
+			if (!cached) {
+				std::istringstream content(request.content);
+				Problem problem(content, request.source, config.neighbours);
+				if (!problem.error.empty()) {
+					reply_error(connection, problem.error);
+					return nullptr;
+				}
+				loaded = cache.insert(key, std::make_shared<LoadedProblem>(std::move(problem)));
+			}
+
+			connection.write("instance " + hash.str() + (cached ? " cached " : " loaded ") + std::to_string(loaded->problem.graph.node_count()) + "\n");
+			return loaded;
+		}
+
+		void solve(Connection& connection, const Request& request) {
+			const auto start = Clock::now();
+
+			if (!request.error.empty()) {
+				reply_error(connection, request.error);
+				return;
+			}
+			if (request.content.empty()) {
+				reply_error(connection, "No instance, send `path` or `instance`");
+				return;
+			}
+			// makeColony exits on unknown colonies
+			const std::string name = request.colony.substr(0, request.colony.find(':'));
+			if (std::none_of(colonies.begin(), colonies.end(), [&](const std::unique_ptr<AbstractColonyFactory>& e) { return e->name() == name; })) {
+				reply_error(connection, "Unknown colony: " + name);
+				return;
+			}
+			std::shared_ptr<UpdateStrategy> update = make_update_strategy(request.update);
+			if (update == nullptr) {
+				reply_error(connection, "Invalid update strategy: " + request.update);
+				return;
+			}
+
+			std::shared_ptr<LoadedProblem> loaded = load(connection, request);
+			if (loaded == nullptr) { return; }
+
+			std::string spec;
+			int threads;
+			std::unique_ptr<AntOptimizer> colony;
+			Profiler pf;
+			try {
+				threads = colony_threads(request.colony, *loaded, config.threads, spec);
+			}
+			catch (const std::exception&) {
+				reply_error(connection, "Invalid colony: " + request.colony);
+				return;
+			}
+
+			slots.acquire(threads);
+			try {
+				colony = makeColony(spec, loaded->problem, loaded->ants, loaded->params);
+				colony->update_best_route(loaded->initial_route);
+				colony->set_update_strategy(update);
+				if (request.seeded) { colony->seed(request.seed); }
+				if (request.seconds > 0) {
+					colony->deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(request.seconds));
+				}
+
+				AntOptimizer& running = *colony;
+				colony->on_improvement = [&](const AntOptimizer& optimizer) {
+					std::ostringstream line;
+					line.precision(4);
+					line << std::fixed << "improved " << optimizer.rounds_done << " " << elapsed_ms(start) << " " << optimizer.best_route.length;
+					for (const auto node : optimizer.best_route.nodes) { line << " " << node; }
+					line << "\n";
+					// Nobody listens anymore
+					if (!connection.write(line.str())) { running.cancel(); }
+				};
+
+				{
+					std::lock_guard<std::mutex> lock(solving_mutex);
+					solving[connection.descriptor()] = colony.get();
+				}
+				pf = colony->optimize(request.rounds);
+				std::lock_guard<std::mutex> lock(solving_mutex);
+				solving.erase(connection.descriptor());
+			}
+			catch (const std::exception& e) {
+				{
+					std::lock_guard<std::mutex> lock(solving_mutex);
+					solving.erase(connection.descriptor());
+				}
+				slots.release(threads);
+				reply_error(connection, "Could not run " + spec + ": " + e.what());
+				return;
+			}
+			slots.release(threads);
+
+			std::ostringstream done;
+			done.precision(4);
+			done << std::fixed << "done " << pf.rounds() << " " << elapsed_ms(start) << " " << colony->best_route.length << "\n";
+			connection.write(done.str());
+
+			std::lock_guard<std::mutex> lock(print_mutex);
+			std::cout.precision(4);
+			std::cout << "[" << loaded->problem.name << "] " << spec << " rounds=" << pf.rounds() << " : best " << colony->best_route.length
+				<< " in " << elapsed_ms(start) << "ms on " << threads << (threads == 1 ? " thread" : " threads") << std::endl;
+		}
+	public:
+		explicit Daemon(const DaemonConfig& config) : config(config), slots(config.threads), cache(config.cache_size) {}
+
+		// Descriptors of the connections a colony is running for
+		std::vector<int> solving_descriptors() {
+			std::lock_guard<std::mutex> lock(solving_mutex);
+			std::vector<int> result;
+			for (const auto& entry : solving) { result.push_back(entry.first); }
+			return result;
+		}
+
+		/*
+			Stops the colony running for `fd` after its current round, e.g. because the client hung up
+		*/
+		void cancel(int fd) {
+			std::lock_guard<std::mutex> lock(solving_mutex);
+			auto it = solving.find(fd);
+			if (it == solving.end()) { return; }
+			it->second->cancel();
+			// Only once, a hung up socket stays readable
+			solving.erase(it);
+		}
+
+		/*
+			Reads and solves one request, false once the connection ended
+		*/
+		bool serve(Connection& connection) {
+			Request request;
+			if (!read_request(connection, request)) { return false; }
+			solve(connection, request);
+			return true;
+		}
+	};
+}
+
+void run_daemon(const DaemonConfig& config) {
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+	const std::string path = config.socket.string();
+	if (path.empty() || path.size() >= sizeof(address.sun_path)) {
+		std::cout << "Socket path has to be 1 to " << sizeof(address.sun_path) - 1 << " characters: " << path << std::endl;
+		exit(1);
+	}
+	std::copy(path.begin(), path.end(), address.sun_path);
+
+	// A socket left behind by a daemon that died is replaced, one that still answers is not
+	struct stat existing;
+	if (stat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode)) {
+		const int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		const bool running = connect(probe, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0;
+		close(probe);
+		if (running) {
+			std::cout << "A daemon is already listening on " << path << std::endl;
+			exit(1);
+		}
+		unlink(path.c_str());
+	}
+
+	const int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	int wake[2];
+	if (listener < 0 || pipe(wake) != 0) {
+		std::cout << "Could not create socket" << std::endl;
+		exit(1);
+	}
+	if (bind(listener, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0 || listen(listener, 64) != 0) {
+		std::cout << "Could not listen on " << path << std::endl;
+		exit(1);
+	}
+
+	install_termination_handler();
+
+	Daemon daemon(config);
+	std::mutex queue_mutex;
+	std::condition_variable queued;
+	// Connections with a request arriving, waiting for a worker
+	std::deque<std::unique_ptr<Connection>> pending;
+	// Connections a worker is done with, handed back to the polling thread through `wake`
+	std::vector<std::unique_ptr<Connection>> returned;
+	bool stopping = false;
+
+	/*
+		The pool is started once and only busy while requests are read and solved,
+		idle connections are watched by the thread below
+	*/
+	std::vector<std::thread> workers;
+	for (int i = 0; i < config.threads; i++) {
+		workers.emplace_back([&]() {
+			while (true) {
+				std::unique_ptr<Connection> connection;
+				{
+					std::unique_lock<std::mutex> lock(queue_mutex);
+					queued.wait(lock, [&]() { return stopping || !pending.empty(); });
+					if (stopping) { return; }
+					connection = std::move(pending.front());
+					pending.pop_front();
+				}
+				if (!daemon.serve(*connection)) { continue; }
+
+				std::lock_guard<std::mutex> lock(queue_mutex);
+				returned.push_back(std::move(connection));
+				// A full pipe wakes the polling thread as well
+				const char signal = 0;
+				[[maybe_unused]] const ssize_t written = write(wake[1], &signal, 1);
+			}
+		});
+	}
+
+	std::cout << "Listening on " << path << " with " << config.threads << (config.threads == 1 ? " thread" : " threads") << std::endl;
+
+	std::vector<std::unique_ptr<Connection>> idle;
+	std::vector<pollfd> waiting;
+	while (!termination_requested()) {
+		waiting.clear();
+		waiting.push_back(pollfd{ listener, POLLIN, 0 });
+		waiting.push_back(pollfd{ wake[0], POLLIN, 0 });
+		for (const auto& connection : idle) {
+			waiting.push_back(pollfd{ connection->descriptor(), POLLIN, 0 });
+		}
+		// Only hang ups, the next request may already be on its way
+		const size_t first_solving = waiting.size();
+		for (const int fd : daemon.solving_descriptors()) {
+			waiting.push_back(pollfd{ fd, 0, 0 });
+		}
+		if (poll(waiting.data(), waiting.size(), poll_interval_ms) <= 0) { continue; }
+
+		for (size_t i = first_solving; i < waiting.size(); i++) {
+			if (waiting[i].revents & (POLLHUP | POLLERR)) { daemon.cancel(waiting[i].fd); }
+		}
+
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		// Readable, hung up or failed: a worker finds out which
+		for (size_t i = idle.size(); i-- > 0;) {
+			if (waiting[i + 2].revents == 0) { continue; }
+			pending.push_back(std::move(idle[i]));
+			idle.erase(idle.begin() + i);
+			queued.notify_one();
+		}
+		if (waiting[1].revents != 0) {
+			char signals[64];
+			[[maybe_unused]] const ssize_t drained = read(wake[0], signals, sizeof(signals));
+			for (auto& connection : returned) {
+				// Requests sent back to back may already be read into the buffer, poll would not see them
+				if (connection->buffered()) {
+					pending.push_back(std::move(connection));
+					queued.notify_one();
+				}
+				else {
+					idle.push_back(std::move(connection));
+				}
+			}
+			returned.clear();
+		}
+		if (waiting[0].revents != 0) {
+			const int fd = accept(listener, nullptr, nullptr);
+			if (fd >= 0) { idle.push_back(std::make_unique<Connection>(fd)); }
+		}
+	}
+
+	// Running colonies stop after their current round, reads return at once
+	{
+		std::lock_guard<std::mutex> lock(queue_mutex);
+		stopping = true;
+	}
+	queued.notify_all();
+	for (auto& worker : workers) {
+		worker.join();
+	}
+
+	close(listener);
+	close(wake[0]);
+	close(wake[1]);
+	unlink(path.c_str());
+	std::cout << "Stopped" << std::endl;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <filesystem>
+
+/*
+	Solver daemon: serves solve requests on a Unix domain socket until SIGTERM or SIGINT,
+	so callers skip process start, parsing and setup of every instance they solved before.
+
+	A request is one `key value` per line, ended by `solve`:
+		path problems/ESC25.sop    instance from a file readable by the daemon, or
+		instance 12345             followed by exactly that many bytes of .sop text
+		colony acs:1               default: serial, `auto` thread counts as in --batch
+		update iteration-best      default: iteration-best
+		rounds 1000                default: 100
+		seconds 2.5                optional wall time budget, the run stops after the round that exceeds it
+		seed 7                     optional
+	Answers stream back one line per event:
+		instance <hash> cached|loaded <nodes>
+		improved <round> <ms> <length> <node> <node> ...
+		done <rounds> <ms> <length>
+		error <message>
+	A connection may send any number of requests one after another.
+*/
+struct DaemonConfig {
+	std::filesystem::path socket;
+	/*
+		Connections served at once and slots of the admission pool: a run starts once its colony's thread count is free.
+		Colonies start their own threads, specs asking for more than `threads` are lowered to it
+	*/
+	int threads = 1;
+	int neighbours = 16;
+	// Parsed instances kept, keyed by a hash of their text. The least recently used one is dropped first
+	size_t cache_size = 16;
+};
+
+/*
+	Returns once terminated by SIGTERM or SIGINT, exits if the socket can not be bound
+*/
+void run_daemon(const DaemonConfig& config);
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <random>
+
+#include "generator.hpp"
+
+namespace {
+	// Weight the bundled instances use for the forbidden edge from the start to the goal
+	constexpr int forbidden = 1000000;
+
+	/*
+		`count` distinct values of [begin, end) appended to `result`
+	*/
+	void sample(std::mt19937& rng, int32_t begin, int32_t end, size_t count, std::vector<int32_t>& result) {
+		const size_t size = end - begin;
+		if (count >= size) {
+			for (int32_t value = begin; value < end; value++) { result.push_back(value); }
+			return;
+		}
+
+		const size_t first = result.size();
+		std::uniform_int_distribution<int32_t> pick(begin, end - 1);
+		while (result.size() - first < count) {
+			const int32_t value = pick(rng);
+			if (std::find(result.begin() + first, result.end(), value) == result.end()) {
+				result.push_back(value);
+			}
+		}
+	}
+
+	// floor(density) predecessors, one more with probability of the fraction
+	size_t predecessor_count(std::mt19937& rng, float density) {
+		const float whole = std::floor(density);
+		return static_cast<size_t>(whole) + (std::uniform_real_distribution<float>(0, 1)(rng) < density - whole ? 1 : 0);
+	}
+
+	int32_t euclidean(const std::vector<int32_t>& coordinates, int32_t from, int32_t to) {
+		const double dx = coordinates[2 * from] - coordinates[2 * to];
+		const double dy = coordinates[2 * from + 1] - coordinates[2 * to + 1];
+		return static_cast<int32_t>(std::sqrt(dx * dx + dy * dy) + 0.5);
+	}
+
+	const char* weights_name(GeneratorConfig::Weights weights) {
+		switch (weights) {
+		case GeneratorConfig::Weights::normal: return "normal";
+		case GeneratorConfig::Weights::euclidean: return "euclidean";
+		default: return "uniform";
+		}
+	}
+
+	const char* structure_name(GeneratorConfig::Structure structure) {
+		switch (structure) {
+		case GeneratorConfig::Structure::chains: return "chains";
+		case GeneratorConfig::Structure::layered: return "layered";
+		default: return "random";
+		}
+	}
+
+	void append(std::string& buffer, int64_t value) {
+		char digits[24];
+		auto end = std::to_chars(digits, digits + sizeof(digits), value).ptr;
+		buffer.append(digits, end);
+	}
+}
+
+bool parse_generator_weights(const std::string& name, GeneratorConfig::Weights& weights) {
+	if (name == "uniform") { weights = GeneratorConfig::Weights::uniform; return true; }
+	if (name == "normal") { weights = GeneratorConfig::Weights::normal; return true; }
+	if (name == "euclidean") { weights = GeneratorConfig::Weights::euclidean; return true; }
+	return false;
+}
+
+bool parse_generator_structure(const std::string& name, GeneratorConfig::Structure& structure) {
+	if (name == "chains") { structure = GeneratorConfig::Structure::chains; return true; }
+	if (name == "layered") { structure = GeneratorConfig::Structure::layered; return true; }
+	if (name == "random") { structure = GeneratorConfig::Structure::random; return true; }
+	return false;
+}
+
+std::vector<std::vector<int32_t>> generate_precedences(const GeneratorConfig& config) {
+	const int32_t n = config.nodes;
+	std::vector<std::vector<int32_t>> predecessors(n);
+	if (n < 4 || config.precedence_density <= 0) { return predecessors; }
+
+	std::mt19937 rng(config.seed);
+	// Hidden order of the interior nodes 1 .. n - 2
+	std::vector<int32_t> order(n - 2);
+	for (int32_t i = 0; i < n - 2; i++) { order[i] = i + 1; }
+	std::shuffle(order.begin(), order.end(), rng);
+	const int32_t m = order.size();
+
+	// Positions in `order` each node depends on
+	std::vector<int32_t> positions;
+	for (int32_t p = 0; p < m; p++) {
+		positions.clear();
+
+		switch (config.structure) {
+		case GeneratorConfig::Structure::chains: {
+			// Density d leaves (1 - d)·m chains, so d·m nodes have a predecessor
+			const int32_t chains = std::max<int32_t>(1, std::lround(m * (1 - std::min(1.0f, config.precedence_density))));
+			if (p >= chains) { positions.push_back(p - chains); }
+			break;
+		}
+		case GeneratorConfig::Structure::layered: {
+			const int32_t layers = std::max<int32_t>(2, std::lround(std::sqrt(m)));
+			const int32_t layer = static_cast<int64_t>(p) * layers / m;
+			if (layer == 0) { break; }
+			// First position of a layer l is ceil(l·m / layers)
+			auto layer_begin = [&](int32_t l) { return static_cast<int32_t>((static_cast<int64_t>(l) * m + layers - 1) / layers); };
+			sample(rng, layer_begin(layer - 1), layer_begin(layer), predecessor_count(rng, config.precedence_density), positions);
+			break;
+		}
+		case GeneratorConfig::Structure::random:
+			sample(rng, 0, p, predecessor_count(rng, config.precedence_density), positions);
+			break;
+		}
+
+		std::vector<int32_t>& list = predecessors[order[p]];
+		for (int32_t position : positions) { list.push_back(order[position]); }
+		std::sort(list.begin(), list.end());
+	}
+
+	return predecessors;
+}
+
+int64_t generate_problem(const GeneratorConfig& config, const std::filesystem::path& path) {
+	const int32_t n = config.nodes;
+	const auto predecessors = generate_precedences(config);
+
+	int64_t precedence_count = 0;
+	for (const auto& list : predecessors) { precedence_count += list.size(); }
+
+	// Integer points, O(N) even for the largest instances
+	std::vector<int32_t> coordinates;
+	if (config.weights == GeneratorConfig::Weights::euclidean) {
+		std::mt19937 rng(config.seed ^ 0x9e3779b9u);
+		std::uniform_int_distribution<int32_t> position(0, config.max_weight);
+		coordinates.resize(2 * static_cast<size_t>(n));
+		for (auto& c : coordinates) { c = position(rng); }
+	}
+
+	std::ofstream file(path);
+	if (!file.is_open()) { return -1; }
+
+	file
+		<< "NAME: " << path.filename().string() << "\n"
+		<< "TYPE: SOP\n"
+		<< "COMMENT: Synthetic, " << weights_name(config.weights) << " weights up to " << config.max_weight << ", "
+			<< structure_name(config.structure) << " precedences (density " << config.precedence_density << "), seed " << config.seed << "\n"
+		<< "DIMENSION: " << n << "\n";
+
+	std::string buffer;
+	if (config.coordinates) {
+		file << "EDGE_WEIGHT_TYPE: EUC_2D\n" << "NODE_COORD_SECTION\n";
+		for (int32_t node = 0; node < n; node++) {
+			buffer.clear();
+			append(buffer, node + 1);
+			buffer += ' ';
+			append(buffer, coordinates[2 * node]);
+			buffer += ' ';
+			append(buffer, coordinates[2 * node + 1]);
+			buffer += '\n';
+			file << buffer;
+		}
+
+		// The start and goal constraints are implicit in this format
+		file << "PRECEDENCE_SECTION\n";
+		for (int32_t node = 0; node < n; node++) {
+			for (int32_t before : predecessors[node]) {
+				file << before + 1 << " " << node + 1 << "\n";
+			}
+		}
+		file << "-1\nEOF\n";
+		file.flush();
+		return file.good() ? precedence_count : -1;
+	}
+
+	file
+		<< "EDGE_WEIGHT_TYPE: EXPLICIT\n"
+		<< "EDGE_WEIGHT_FORMAT: FULL_MATRIX\n"
+		<< "EDGE_WEIGHT_SECTION\n"
+		<< n << "\n";
+
+	const double mean = config.max_weight / 2.0;
+	std::normal_distribution<double> normal(mean, config.max_weight / 6.0);
+	std::uniform_int_distribution<int32_t> uniform(0, config.max_weight);
+
+	for (int32_t from = 0; from < n; from++) {
+		// Every row has its own generator, so rows do not depend on each other
+		std::seed_seq row_seed{ config.seed, static_cast<unsigned int>(from) };
+		std::mt19937 rng(row_seed);
+		normal.reset();
+		auto before = predecessors[from].begin();
+		const auto before_end = predecessors[from].end();
+
+		buffer.clear();
+		for (int32_t to = 0; to < n; to++) {
+			int64_t value;
+			while (before != before_end && *before < to) { before++; }
+
+			if (to == from) {
+				value = 0;
+			}
+			else if (to == 0 || from == n - 1 || (before != before_end && *before == to)) {
+				// `to` has to be visited before `from`
+				value = -1;
+			}
+			else if (from == 0 && to == n - 1) {
+				value = forbidden;
+			}
+			else if (config.weights == GeneratorConfig::Weights::euclidean) {
+				value = euclidean(coordinates, from, to);
+			}
+			else if (config.weights == GeneratorConfig::Weights::normal) {
+				value = std::clamp<int64_t>(std::lround(normal(rng)), 0, config.max_weight);
+			}
+			else {
+				value = uniform(rng);
+			}
+
+			if (to > 0) { buffer += ' '; }
+			append(buffer, value);
+		}
+		buffer += '\n';
+		file << buffer;
+	}
+
+	file << "EOF\n";
+	file.flush();
+	return file.good() ? precedence_count : -1;
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*
+	Synthetic SOP instances for scaling tests.
+
+	Interior nodes get a hidden random order and precedences only point forward in it, so every instance is solvable.
+	Like the bundled instances the first node is the start and the last node the goal.
+*/
+struct GeneratorConfig {
+	enum class Weights { uniform, normal, euclidean };
+	// How the precedences are laid out along the hidden order
+	enum class Structure {
+		// Nodes are dealt round robin into chains, each node depends on the previous one of its chain
+		chains,
+		// The order is cut into about √N layers, nodes depend on nodes of the previous layer
+		layered,
+		// Nodes depend on any nodes earlier in the order
+		random
+	};
+
+	static constexpr int max_nodes = 50000;
+
+	int nodes = 1000;
+	Weights weights = Weights::uniform;
+	// Weights are drawn from [0, max_weight], euclidean nodes lie in a max_weight x max_weight square
+	int max_weight = 1000;
+	// Average number of direct predecessors of an interior node (at most 1 for chains)
+	float precedence_density = 0.5;
+	Structure structure = Structure::random;
+	// Write NODE_COORD_SECTION + PRECEDENCE_SECTION instead of the dense matrix, euclidean weights only
+	bool coordinates = false;
+	unsigned int seed = 1;
+};
+
+bool parse_generator_weights(const std::string& name, GeneratorConfig::Weights& weights);
+bool parse_generator_structure(const std::string& name, GeneratorConfig::Structure& structure);
+
+/*
+	Direct predecessors of every node (without the implicit start and goal constraints), each list sorted
+*/
+std::vector<std::vector<int32_t>> generate_precedences(const GeneratorConfig& config);
+
+/*
+	Writes an instance to `path`. Matrix rows are generated and written one at a time,
+	nothing N² is held in memory.
+	Returns the number of generated precedences (without start and goal) or -1 if `path` could not be written.
+*/
+int64_t generate_problem(const GeneratorConfig& config, const std::filesystem::path& path);
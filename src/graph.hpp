@@ -5,6 +5,8 @@
 #include <set>
 #include <algorithm>
 
+#include "memory.hpp"
+
 namespace graph {
 
 	using Node = int32_t;
@@ -12,10 +14,11 @@ namespace graph {
 
 	const Node NO_NODE = -1;
 
-	using NodeList = std::set<Node>;
-	using EdgeList = std::set<Edge>;
+	// Node based containers count their bytes, see --mem-report
+	using NodeList = std::set<Node, std::less<Node>, CountingAllocator<Node>>;
+	using EdgeList = std::set<Edge, std::less<Edge>, CountingAllocator<Edge>>;
 
-	using AdjacencyEntry = std::set<Node>;
+	using AdjacencyEntry = std::set<Node, std::less<Node>, CountingAllocator<Node>>;
 
 	using AdjacencyList = std::vector<AdjacencyEntry>;
 
@@ -121,5 +124,59 @@ namespace graph {
 
 	using UndirectedGraph = Graph<false>;
 	using DirectedGraph = Graph<true>;
+
+	/*
+		Directed graph in CSR form, the edges of `from` go to
+			targets[offsets[from]] .. targets[offsets[from + 1]]
+		in ascending order. Built row by row with `add_row`, 4 bytes per edge instead of a set node.
+	*/
+	struct Adjacency {
+		std::vector<size_t> offsets = { 0 };
+		std::vector<Node> targets;
+
+		size_t node_count() const {
+			return offsets.size() - 1;
+		}
+
+		size_t edge_count() const {
+			return targets.size();
+		}
+
+		bool has_node(Node node) const {
+			return node >= 0 && node < node_count();
+		}
+
+		const Node* begin(Node from) const {
+			return targets.data() + offsets[from];
+		}
+
+		const Node* end(Node from) const {
+			return targets.data() + offsets[from + 1];
+		}
+
+		bool has_edge(Node from, Node to) const {
+			return has_node(from) && ::std::binary_search(begin(from), end(from), to);
+		}
+
+		bool has_edge(Edge edge) const {
+			return has_edge(edge.first, edge.second);
+		}
+
+		// Ends the row of the next node, its targets were pushed to `targets` in ascending order
+		void add_row() {
+			offsets.push_back(targets.size());
+		}
+
+		DirectedGraph to_graph() const {
+			DirectedGraph result(node_count());
+			for (Node from = 0; from < node_count(); from++) {
+				for (const Node* to = begin(from); to != end(from); to++) {
+					result.edges.emplace_hint(result.edges.end(), from, *to);
+					result.adjacency_list[from].emplace_hint(result.adjacency_list[from].end(), *to);
+				}
+			}
+			return result;
+		}
+	};
 }
 
@@ -0,0 +1,233 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+#include "heuristic.hpp"
+
+Route nearest_neighbour_route(const graph::Adjacency& graph, const InstanceView& instance) {
+
+	const graph::Node goal = graph.node_count() - 1;
+
+	// Same bookkeeping as `Ant::allowed_nodes`
+	std::vector<int> allowed_nodes(graph.node_count(), 0);
+	for (graph::Node node = 0; node < graph.node_count(); node++) {
+		for (auto it = instance.dependents_begin(node), end = instance.dependents_end(node); it != end; it++) {
+			allowed_nodes.at(*it) += 1;
+		}
+	}
+
+	Route route(0);
+	graph::Node current = 0;
+	long long length = 0;
+
+	auto visit = [&](graph::Node node) {
+		allowed_nodes.at(node) = -1;
+		route.nodes.push_back(node);
+		for (auto it = instance.dependents_begin(node), end = instance.dependents_end(node); it != end; it++) {
+			allowed_nodes.at(*it) -= 1;
+		}
+	};
+
+	visit(current);
+	while (current != goal) {
+		graph::Node next = graph::NO_NODE;
+		int next_weight = std::numeric_limits<int>::max();
+
+		for (const graph::Node* it = graph.begin(current); it != graph.end(current); it++) {
+			const graph::Node node = *it;
+			if (allowed_nodes.at(node) != 0) { continue; }
+			// The goal has to be the last node visited
+			if (node == goal && route.nodes.size() + 1 < graph.node_count()) { continue; }
+
+			int weight = instance.weight(current, node);
+			if (weight < next_weight) {
+				next = node;
+				next_weight = weight;
+			}
+		}
+
+		// Neighbour lists used up, take the closest node left
+		if (next == graph::NO_NODE && instance.candidate_lists()) {
+			for (graph::Node node = 0; node < graph.node_count(); node++) {
+				if (allowed_nodes.at(node) != 0 || node == current) { continue; }
+				if (node == goal && route.nodes.size() + 1 < graph.node_count()) { continue; }
+
+				int weight = instance.weight(current, node);
+				if (next == graph::NO_NODE || weight < next_weight) {
+					next = node;
+					next_weight = weight;
+				}
+			}
+		}
+
+		if (next == graph::NO_NODE) {
+			return Route(-1);
+		}
+
+		length += next_weight;
+		visit(next);
+		current = next;
+	}
+
+	if (length >= std::numeric_limits<int>::max()) {
+		return Route(-1);
+	}
+
+	route.length = static_cast<int>(length);
+	return route;
+}
+
+void derive_pheromone_bounds(Parameters& params, const Route& route, size_t node_count, float p_best) {
+	if (route.length <= 0) { return; }
+
+	float n = static_cast<float>(node_count);
+	float tau_max = 1.0f / (params.roh * route.length);
+	float p_dec = std::pow(p_best, 1.0f / n);
+	float tau_min = tau_max * (1.0f - p_dec) / (std::max(n / 2.0f - 1.0f, 1.0f) * p_dec);
+
+	params.q = 1.0f;
+	params.max_pheromone = tau_max;
+	params.min_pheromone = std::min(tau_min, tau_max);
+	params.initial_pheromone = tau_max;
+}
+
+size_t default_ant_count(const Problem& problem) {
+	const size_t n = problem.graph.node_count();
+	return problem.instance.candidate_lists() ? std::min(n, max_candidate_list_ants) : n;
+}
+
+Parameters default_parameters(const Problem& problem, const Route& initial_route) {
+	int max_dist = 0;
+	for (graph::Node from = 0; from < problem.graph.node_count(); from++) {
+		for (const graph::Node* to = problem.graph.begin(from); to != problem.graph.end(from); to++) {
+			int weight = problem.instance.weight(from, *to);
+			if (weight == std::numeric_limits<int>::max()) { continue; }
+			max_dist = std::max(weight, max_dist);
+		}
+	}
+
+	Parameters params;
+	params.initial_pheromone = 0.01;
+	params.alpha = 1.0;
+	params.beta = 0.5;
+	params.roh = 0.25;
+	params.q = max_dist;
+	params.min_pheromone = 0.01;
+	params.max_pheromone = 100;
+	params.zero_distance = 0.1;
+
+	// Scale pheromone to the instance instead of waiting for it to drift there
+	derive_pheromone_bounds(params, initial_route, problem.graph.node_count());
+
+	return params;
+}
+
+Route validate_route(std::vector<graph::Node> nodes, const Problem& problem, std::string& error) {
+	const graph::Node n = problem.graph.node_count();
+	if (nodes.size() != static_cast<size_t>(n)) {
+		error = "Tour has " + std::to_string(nodes.size()) + " nodes, the problem " + std::to_string(n);
+		return Route(-1);
+	}
+	if (nodes.front() != 0 || nodes.back() != n - 1) {
+		error = "Tour has to start at node 0 and end at node " + std::to_string(n - 1);
+		return Route(-1);
+	}
+
+	// Dependencies not visited yet, like `Ant::allowed_nodes`
+	const InstanceView& instance = problem.instance;
+	std::vector<int> waiting(n, 0);
+	for (graph::Node node = 0; node < n; node++) {
+		for (auto it = instance.dependents_begin(node), end = instance.dependents_end(node); it != end; it++) {
+			waiting[*it]++;
+		}
+	}
+
+	long long length = 0;
+	for (size_t i = 0; i < nodes.size(); i++) {
+		const graph::Node node = nodes[i];
+		if (node < 0 || node >= n) {
+			error = "Node " + std::to_string(node) + " does not exist";
+			return Route(-1);
+		}
+		if (waiting[node] < 0) {
+			error = "Node " + std::to_string(node) + " is visited twice";
+			return Route(-1);
+		}
+		if (waiting[node] > 0) {
+			for (graph::Node before = 0; before < n && error.empty(); before++) {
+				if (waiting[before] < 0 || std::find(instance.dependents_begin(before), instance.dependents_end(before), node) == instance.dependents_end(before)) { continue; }
+				error = "Node " + std::to_string(node) + " is visited before " + std::to_string(before);
+			}
+			return Route(-1);
+		}
+
+		waiting[node] = -1;
+		for (auto it = instance.dependents_begin(node), end = instance.dependents_end(node); it != end; it++) {
+			waiting[*it]--;
+		}
+
+		if (i == 0) { continue; }
+		const graph::Node previous = nodes[i - 1];
+		const int weight = problem.instance.weight(previous, node);
+		if ((!problem.instance.candidate_lists() && !problem.instance.has_edge(previous, node)) || weight == std::numeric_limits<int>::max()) {
+			error = "Arc " + std::to_string(previous) + " -> " + std::to_string(node) + " is forbidden";
+			return Route(-1);
+		}
+		length += weight;
+	}
+
+	if (length >= std::numeric_limits<int>::max()) {
+		error = "Tour is too long";
+		return Route(-1);
+	}
+
+	Route route(static_cast<int>(length));
+	route.nodes = std::move(nodes);
+	return route;
+}
+
+Route read_tour(const std::filesystem::path& path, const Problem& problem, std::string& error) {
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		error = "Could not open " + path.string();
+		return Route(-1);
+	}
+
+	std::vector<graph::Node> nodes;
+	bool tsplib = false;
+	bool section = false;
+	for (std::string line; std::getline(file, line);) {
+		if (line.rfind("TOUR_SECTION", 0) == 0) {
+			tsplib = section = true;
+			continue;
+		}
+		// Header of a TSPLIB tour (NAME: ..., TYPE: TOUR, ...)
+		if (!section && line.find(':') != std::string::npos) {
+			tsplib = true;
+			continue;
+		}
+		if (tsplib && !section) { continue; }
+
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::istringstream values(line);
+		for (std::string value; values >> value;) {
+			if (value == "--") { continue; }
+			if ((section && value == "-1") || value == "EOF") {
+				return validate_route(std::move(nodes), problem, error);
+			}
+
+			char* end;
+			const long node = std::strtol(value.c_str(), &end, 10);
+			if (*end != '\0' || end == value.c_str()) {
+				error = "Not a node: " + value;
+				return Route(-1);
+			}
+			nodes.push_back(static_cast<graph::Node>(tsplib ? node - 1 : node));
+		}
+	}
+
+	return validate_route(std::move(nodes), problem, error);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "graph.hpp"
+#include "problem.hpp"
+#include "colonies/base.hpp"
+
+/*
+	Builds a route by always travelling to the closest node whose
+	dependencies have all been visited (nearest neighbour in topological order).
+	Forbidden edges (weight of int::max) are never taken.
+
+	Returns a route with length -1 if the construction runs into a dead end.
+*/
+Route nearest_neighbour_route(const graph::Adjacency& graph, const InstanceView& instance);
+
+/*
+	Length of visiting `nodes` in this order. Returns a route with length -1 and explains in `error`
+	unless every node comes exactly once, the start first, the goal last, every node after all its
+	dependencies and no arc is forbidden.
+*/
+Route validate_route(std::vector<graph::Node> nodes, const Problem& problem, std::string& error);
+
+/*
+	Reads a tour for `problem` from `path`, either TSPLIB (.tour with a TOUR_SECTION of 1 based nodes ended by -1)
+	or a plain list of 0 based nodes as printed by -v, separated by whitespace, commas or `--`.
+	The route is validated like `validate_route`.
+*/
+Route read_tour(const std::filesystem::path& path, const Problem& problem, std::string& error);
+
+/*
+	Derives the Max-Min pheromone bounds from the length of a known route
+	as proposed for MMAS by Stützle and Hoos:
+
+		tau_max = 1 / (roh * L)
+		tau_min = tau_max * (1 - p_dec) / ((n / 2 - 1) * p_dec)    with p_dec = p_best ^ (1 / n)
+
+	Trails start at tau_max and every ant deposits 1 / L_k (q = 1).
+*/
+void derive_pheromone_bounds(Parameters& params, const Route& route, size_t node_count, float p_best = 0.05);
+
+/*
+	Number of ants used for `problem` by all modes: one per node.
+	Neighbour list instances are meant to be large, every ant holds O(N) state,
+	so they are capped at `max_candidate_list_ants`.
+*/
+constexpr size_t max_candidate_list_ants = 100;
+size_t default_ant_count(const Problem& problem);
+
+/*
+	Parameters used for `problem` by all modes.
+	Pheromone bounds are derived from `initial_route` if it is a valid route.
+*/
+Parameters default_parameters(const Problem& problem, const Route& initial_route);
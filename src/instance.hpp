@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "graph.hpp"
+
+/*
+	Non owning view of the weights and precedence constraints of a problem.
+	Points either into a memory mapped problem cache or into storage owned by `Problem`.
+
+	Explicit instances have a dense weight matrix. Coordinate instances (TSPLIB NODE_COORD_SECTION)
+	compute weights on demand from `coordinates` instead, so they never hold anything N².
+*/
+struct InstanceView {
+	// Weight of a node pair that is no edge (diagonal and precedence constraints)
+	static constexpr int32_t NO_EDGE = -1;
+
+	// TSPLIB EDGE_WEIGHT_TYPE
+	enum class Metric : int32_t { explicit_matrix, euc_2d, ceil_2d, att };
+
+	int32_t dimension = 0;
+	Metric metric = Metric::explicit_matrix;
+	// Dense row major dimension x dimension matrix, nullptr for coordinate instances
+	const int32_t* weights = nullptr;
+	// x, y of every node, nullptr for explicit instances
+	const double* coordinates = nullptr;
+	/*
+		Precedence lists in CSR form: the nodes depending on `node` are
+			precedence[precedence_offsets[node]] .. precedence[precedence_offsets[node + 1]]
+	*/
+	const int32_t* precedence_offsets = nullptr;
+	const int32_t* precedence = nullptr;
+
+	int32_t weight(graph::Node from, graph::Node to) const {
+		if (weights != nullptr) {
+			return weights[static_cast<size_t>(from) * dimension + to];
+		}
+		return cached_distance(from, to);
+	}
+
+	bool has_edge(graph::Node from, graph::Node to) const {
+		return weight(from, to) != NO_EDGE;
+	}
+
+	/*
+		True if the graph of the problem only holds each node's nearest neighbours
+		and ants may have to leave it once those are used up
+	*/
+	bool candidate_lists() const {
+		return coordinates != nullptr;
+	}
+
+	const int32_t* dependents_begin(graph::Node node) const {
+		return precedence + precedence_offsets[node];
+	}
+
+	const int32_t* dependents_end(graph::Node node) const {
+		return precedence + precedence_offsets[node + 1];
+	}
+
+	size_t precedence_count() const {
+		return dimension > 0 ? precedence_offsets[dimension] : 0;
+	}
+
+	// Bytes of the arrays this view points to
+	size_t bytes() const {
+		const size_t n = dimension;
+		const size_t data = weights != nullptr ? n * n * sizeof(int32_t) : coordinates != nullptr ? 2 * n * sizeof(double) : 0;
+		return data + (n + 1 + precedence_count()) * sizeof(int32_t);
+	}
+
+	/*
+		Distance by the TSPLIB definition of `metric`
+	*/
+	int32_t distance(graph::Node from, graph::Node to) const {
+		if (from == to) { return NO_EDGE; }
+
+		const double dx = coordinates[2 * from] - coordinates[2 * to];
+		const double dy = coordinates[2 * from + 1] - coordinates[2 * to + 1];
+		switch (metric) {
+		case Metric::ceil_2d:
+			return static_cast<int32_t>(std::ceil(std::sqrt(dx * dx + dy * dy)));
+		case Metric::att: {
+			// Pseudo euclidean, rounded up
+			const double r = std::sqrt((dx * dx + dy * dy) / 10.0);
+			const int32_t t = static_cast<int32_t>(r + 0.5);
+			return t < r ? t + 1 : t;
+		}
+		default:
+			return static_cast<int32_t>(std::sqrt(dx * dx + dy * dy) + 0.5);
+		}
+	}
+
+private:
+	/*
+		`distance` behind a small direct mapped cache per thread.
+		Evaluating a route and scanning for a node outside the neighbour lists
+		ask for the same pairs every round, no locking needed between the ant threads.
+	*/
+	int32_t cached_distance(graph::Node from, graph::Node to) const {
+		struct Entry {
+			const double* coordinates = nullptr;
+			graph::Node from = 0;
+			graph::Node to = 0;
+			int32_t weight = 0;
+		};
+		static constexpr size_t cache_size = 1024;
+		thread_local Entry cache[cache_size];
+
+		Entry& entry = cache[(static_cast<uint32_t>(from) * 2654435761u ^ static_cast<uint32_t>(to)) % cache_size];
+		if (entry.coordinates != coordinates || entry.from != from || entry.to != to) {
+			entry = Entry{ coordinates, from, to, distance(from, to) };
+		}
+		return entry.weight;
+	}
+};
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <cstring>
+
+#include "antopt.h"
+#include "solver.hpp"
+
+struct antopt_handle {
+	std::unique_ptr<SolveHandle> handle;
+};
+
+namespace {
+	int fail(const std::string& message, char* error, size_t error_size) {
+		if (error != nullptr && error_size > 0) {
+			const size_t size = std::min(message.size(), error_size - 1);
+			std::memcpy(error, message.data(), size);
+			error[size] = '\0';
+		}
+		return -1;
+	}
+
+	SolverInstance borrow(const antopt_instance& instance) {
+		SolverInstance borrowed;
+		borrowed.dimension = instance.dimension;
+		borrowed.weights = instance.weights;
+		borrowed.precedence_offsets = instance.precedence_offsets;
+		borrowed.precedence = instance.precedence;
+		return borrowed;
+	}
+
+	SolveOptions copy(const antopt_options& options) {
+		SolveOptions copied;
+		if (options.colony != nullptr) { copied.colony = options.colony; }
+		if (options.update != nullptr) { copied.update = options.update; }
+		copied.rounds = options.rounds;
+		copied.seconds = options.seconds;
+		copied.seeded = options.seeded != 0;
+		copied.seed = options.seed;
+		if (options.progress != nullptr) {
+			// The run may outlive `options`
+			copied.progress = [progress = options.progress, user = options.user](const SolveProgress& p) {
+				return progress(user, p.round, p.elapsed_ms, p.best_length, p.best_route.data(), static_cast<int32_t>(p.best_route.size())) != 0;
+			};
+		}
+		return copied;
+	}
+}
+
+antopt_options antopt_default_options(void) {
+	const SolveOptions defaults;
+	antopt_options options;
+	options.colony = nullptr;
+	options.update = nullptr;
+	options.rounds = defaults.rounds;
+	options.seconds = defaults.seconds;
+	options.seeded = 0;
+	options.seed = 0;
+	options.progress = nullptr;
+	options.user = nullptr;
+	return options;
+}
+
+antopt_handle* antopt_start(const antopt_instance* instance, const antopt_options* options) {
+	if (instance == nullptr || options == nullptr) { return nullptr; }
+
+	// Exceptions must not cross into C
+	try {
+		return new antopt_handle{ start(borrow(*instance), copy(*options)) };
+	}
+	catch (const std::exception&) {
+		return nullptr;
+	}
+}
+
+int32_t antopt_best(const antopt_handle* handle, int32_t* route) {
+	const SolveResult best = handle->handle->best_so_far();
+	if (route != nullptr) { std::copy(best.route.begin(), best.route.end(), route); }
+	return best.length;
+}
+
+int32_t antopt_round(const antopt_handle* handle) {
+	return handle->handle->round();
+}
+
+void antopt_cancel(antopt_handle* handle) {
+	handle->handle->cancel();
+}
+
+int antopt_wait(antopt_handle* handle, double timeout_ms) {
+	const auto timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double, std::milli>(timeout_ms));
+	return handle->handle->wait_for(timeout) ? 1 : 0;
+}
+
+int antopt_finish(antopt_handle* handle, antopt_result* result, int32_t* route, char* error, size_t error_size) {
+	const std::unique_ptr<antopt_handle> owned(handle);
+	if (handle == nullptr || result == nullptr) {
+		return fail("handle and result are required", error, error_size);
+	}
+
+	try {
+		const SolveResult solved = handle->handle->result();
+		result->length = solved.length;
+		result->rounds = solved.rounds;
+		result->elapsed_ms = solved.elapsed_ms;
+		if (!solved.error.empty()) { return fail(solved.error, error, error_size); }
+		if (route != nullptr) { std::copy(solved.route.begin(), solved.route.end(), route); }
+		return 0;
+	}
+	catch (const std::exception& e) {
+		return fail(e.what(), error, error_size);
+	}
+}
+
+int antopt_solve(const antopt_instance* instance, const antopt_options* options, antopt_result* result,
+	int32_t* route, char* error, size_t error_size) {
+	if (instance == nullptr || options == nullptr || result == nullptr) {
+		return fail("instance, options and result are required", error, error_size);
+	}
+
+	antopt_handle* handle = antopt_start(instance, options);
+	if (handle == nullptr) { return fail("Could not start the solver", error, error_size); }
+	return antopt_finish(handle, result, route, error, error_size);
+}
@@ -0,0 +1,85 @@
+#ifndef ANTOPT_H
+#define ANTOPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+	C interface of libantopt.a, see solver.hpp for the C++ one and the meaning of every field.
+	Link with -lantopt -lstdc++ -pthread.
+*/
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+	Borrowed by `antopt_solve`, the arrays are read in place. A run allocates about 8 bytes per arc for indices,
+	12 per arc (or node pair) for the colony and 4 * dimension² for the ants, see SolverInstance in solver.hpp.
+	weights: dimension * dimension row major, -1 = no arc, INT32_MAX = forbidden arc.
+	Dependents of node i: precedence[precedence_offsets[i]] .. precedence[precedence_offsets[i + 1]]
+*/
+typedef struct antopt_instance {
+	int32_t dimension;
+	const int32_t* weights;
+	const int32_t* precedence_offsets;
+	const int32_t* precedence;
+} antopt_instance;
+
+/*
+	Called after every round that improved the best route, return 0 to stop after it.
+	`route` is only valid during the call.
+*/
+typedef int (*antopt_progress)(void* user, int32_t round, double elapsed_ms, int32_t length, const int32_t* route, int32_t size);
+
+typedef struct antopt_options {
+	// Colony spec as for -t, NULL for serial
+	const char* colony;
+	// NULL for iteration-best
+	const char* update;
+	int32_t rounds;
+	// 0: no time limit
+	double seconds;
+	int32_t seeded;
+	uint32_t seed;
+	antopt_progress progress;
+	void* user;
+} antopt_options;
+
+typedef struct antopt_result {
+	int32_t length;
+	int32_t rounds;
+	double elapsed_ms;
+} antopt_result;
+
+antopt_options antopt_default_options(void);
+
+/*
+	Solves `instance`, writes `dimension` nodes to `route` (may be NULL).
+	Returns 0 on success, -1 with a message in `error` (may be NULL, truncated to `error_size`) otherwise.
+*/
+int antopt_solve(const antopt_instance* instance, const antopt_options* options, antopt_result* result,
+	int32_t* route, char* error, size_t error_size);
+
+/*
+	Run on its own thread, see SolveHandle in solver.hpp. `instance` has to stay valid until `antopt_finish`,
+	`options` is copied. Returns NULL if `instance` or `options` is NULL.
+*/
+typedef struct antopt_handle antopt_handle;
+antopt_handle* antopt_start(const antopt_instance* instance, const antopt_options* options);
+
+// Length of the best route so far (-1 before the first), its `dimension` nodes go to `route` (may be NULL). Lock free
+int32_t antopt_best(const antopt_handle* handle, int32_t* route);
+int32_t antopt_round(const antopt_handle* handle);
+// Stops the run before its next ant
+void antopt_cancel(antopt_handle* handle);
+// 1 once the run ended within `timeout_ms`, 0 otherwise
+int antopt_wait(antopt_handle* handle, double timeout_ms);
+// Waits for the run, fills in the result like `antopt_solve` and frees `handle`
+int antopt_finish(antopt_handle* handle, antopt_result* result, int32_t* route, char* error, size_t error_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/*
+	Best route of a running colony, written by the solving thread and read by any number of others
+	without locks (seqlock): readers copy it and retry if a publish overlapped their copy.
+	Nodes are atomics read and written relaxed, so a torn copy is discarded instead of being undefined behaviour.
+*/
+class RouteSnapshot {
+	std::atomic<uint64_t> sequence{ 0 };
+	std::atomic<int32_t> length{ -1 };
+	std::atomic<size_t> size{ 0 };
+	std::unique_ptr<std::atomic<int32_t>[]> nodes;
+	size_t capacity;
+public:
+	explicit RouteSnapshot(size_t capacity) : nodes(new std::atomic<int32_t>[capacity]), capacity(capacity) {}
+
+	// Single writer
+	void publish(int32_t route_length, const std::vector<int32_t>& route) {
+		const uint64_t current = sequence.load(std::memory_order_relaxed);
+		sequence.store(current + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		const size_t count = std::min(route.size(), capacity);
+		for (size_t i = 0; i < count; i++) { nodes[i].store(route[i], std::memory_order_relaxed); }
+		size.store(count, std::memory_order_relaxed);
+		length.store(route_length, std::memory_order_relaxed);
+
+		sequence.store(current + 2, std::memory_order_release);
+	}
+
+	/*
+		Copies the route into `route` and returns its length, -1 before the first publish
+	*/
+	int32_t read(std::vector<int32_t>& route) const {
+		while (true) {
+			const uint64_t before = sequence.load(std::memory_order_acquire);
+			if (before & 1) {
+				std::this_thread::yield();
+				continue;
+			}
+
+			const int32_t route_length = length.load(std::memory_order_relaxed);
+			route.resize(size.load(std::memory_order_relaxed));
+			for (size_t i = 0; i < route.size(); i++) { route[i] = nodes[i].load(std::memory_order_relaxed); }
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			if (sequence.load(std::memory_order_relaxed) == before) { return route_length; }
+		}
+	}
+};
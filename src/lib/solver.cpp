@@ -0,0 +1,213 @@
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "solver.hpp"
+#include "snapshot.hpp"
+#include "../heuristic.hpp"
+#include "../problem.hpp"
+#include "../colonies/registry.hpp"
+#include "../colonies/update.hpp"
+
+namespace {
+	typedef std::chrono::steady_clock Clock;
+
+	double elapsed_ms(Clock::time_point since) {
+		return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+	}
+
+	void register_colonies() {
+		static std::once_flag once;
+		// A program linking the library may have registered them itself
+		std::call_once(once, [] { if (colonies.empty()) { init_colonies(); } });
+	}
+
+	/*
+		Everything the colonies would otherwise trust blindly, empty if `instance` is usable
+	*/
+	std::string check_instance(const SolverInstance& instance) {
+		const int32_t n = instance.dimension;
+		if (n < 2) { return "Instance needs a start and a goal node"; }
+		if (instance.weights == nullptr || instance.precedence_offsets == nullptr) { return "Instance without weights or precedence offsets"; }
+
+		const size_t cells = static_cast<size_t>(n) * n;
+		for (size_t i = 0; i < cells; i++) {
+			if (instance.weights[i] < 0 && instance.weights[i] != InstanceView::NO_EDGE) {
+				return "Negative weight from " + std::to_string(i / n) + " to " + std::to_string(i % n);
+			}
+		}
+
+		if (instance.precedence_offsets[0] != 0) { return "precedence_offsets[0] has to be 0"; }
+		for (int32_t node = 0; node < n; node++) {
+			if (instance.precedence_offsets[node + 1] < instance.precedence_offsets[node]) {
+				return "precedence_offsets decrease at node " + std::to_string(node);
+			}
+		}
+		if (instance.precedence_offsets[n] > 0 && instance.precedence == nullptr) { return "Instance without precedence list"; }
+		for (int32_t node = 0; node < n; node++) {
+			for (int32_t i = instance.precedence_offsets[node]; i < instance.precedence_offsets[node + 1]; i++) {
+				const int32_t dependent = instance.precedence[i];
+				if (dependent < 0 || dependent >= n || dependent == node) {
+					return "Invalid dependent " + std::to_string(dependent) + " of node " + std::to_string(node);
+				}
+			}
+		}
+		return "";
+	}
+}
+
+std::vector<std::string> solver_colonies() {
+	register_colonies();
+	std::vector<std::string> names;
+	for (const auto& e : colonies) { names.push_back(e->name()); }
+	return names;
+}
+
+struct SolveHandle::Run {
+	const SolverInstance instance;
+	const SolveOptions options;
+	const Clock::time_point start = Clock::now();
+	RouteSnapshot best;
+
+	// Guards `colony` while it is created and `cancelled`, `finished`, `outcome`
+	mutable std::mutex mutex;
+	std::condition_variable finish_line;
+	std::unique_ptr<AntOptimizer> colony;
+	bool cancelled = false;
+	bool finished = false;
+	SolveResult outcome;
+	std::thread thread;
+
+	Run(const SolverInstance& instance, SolveOptions options)
+	: instance(instance), options(std::move(options)), best(std::max(instance.dimension, 0)) {}
+
+	void solve(SolveResult& result) {
+		result.error = check_instance(instance);
+		if (!result.error.empty()) { return; }
+
+		// makeColony exits on unknown colonies
+		const std::string name = options.colony.substr(0, options.colony.find(':'));
+		if (std::none_of(colonies.begin(), colonies.end(), [&](const std::unique_ptr<AbstractColonyFactory>& e) { return e->name() == name; })) {
+			result.error = "Unknown colony: " + name;
+			return;
+		}
+		std::shared_ptr<UpdateStrategy> update = make_update_strategy(options.update);
+		if (update == nullptr) {
+			result.error = "Invalid update strategy: " + options.update;
+			return;
+		}
+
+		InstanceView view;
+		view.dimension = instance.dimension;
+		view.weights = instance.weights;
+		view.precedence_offsets = instance.precedence_offsets;
+		view.precedence = instance.precedence;
+
+		const Problem problem(view, "in-memory");
+		const std::vector<Ant> ants(default_ant_count(problem), Ant(0));
+		const Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+
+		// The colony refers to `problem` and `ants`, it has to go first (also when an exception leaves)
+		struct Release {
+			Run& run;
+			~Release() {
+				std::lock_guard<std::mutex> lock(run.mutex);
+				run.colony.reset();
+			}
+		} release{ *this };
+
+		{
+			std::unique_ptr<AntOptimizer> created = makeColony(options.colony, problem, ants, default_parameters(problem, initial_route));
+			created->update_best_route(initial_route);
+			best.publish(created->best_route.length, created->best_route.nodes);
+			created->set_update_strategy(update);
+			if (options.seeded) { created->seed(options.seed); }
+			if (options.seconds > 0) {
+				created->deadline = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.seconds));
+			}
+			created->on_improvement = [this](const AntOptimizer& optimizer) {
+				best.publish(optimizer.best_route.length, optimizer.best_route.nodes);
+				if (!options.progress) { return; }
+				const SolveProgress progress{ optimizer.rounds_done, elapsed_ms(start), optimizer.best_route.length, optimizer.best_route.nodes };
+				if (!options.progress(progress)) { colony->cancel(); }
+			};
+
+			std::lock_guard<std::mutex> lock(mutex);
+			colony = std::move(created);
+			if (cancelled) { colony->cancel(); }
+		}
+
+		const Profiler pf = colony->optimize(options.rounds);
+		result.rounds = pf.rounds();
+		result.length = colony->best_route.length;
+		result.route = colony->best_route.nodes;
+	}
+
+	void run() {
+		SolveResult result;
+		try {
+			solve(result);
+		}
+		catch (const std::exception& e) {
+			result.error = "Could not run " + options.colony + ": " + e.what();
+		}
+		result.elapsed_ms = elapsed_ms(start);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		outcome = std::move(result);
+		finished = true;
+		finish_line.notify_all();
+	}
+};
+
+SolveHandle::SolveHandle(std::unique_ptr<Run> run) : run(std::move(run)) {}
+
+SolveHandle::~SolveHandle() {
+	cancel();
+	run->thread.join();
+}
+
+SolveResult SolveHandle::best_so_far() const {
+	SolveResult result;
+	result.length = run->best.read(result.route);
+	result.rounds = round();
+	result.elapsed_ms = elapsed_ms(run->start);
+	return result;
+}
+
+int SolveHandle::round() const {
+	std::lock_guard<std::mutex> lock(run->mutex);
+	if (run->finished) { return run->outcome.rounds; }
+	return run->colony != nullptr ? run->colony->rounds_done.load() : 0;
+}
+
+void SolveHandle::cancel() {
+	std::lock_guard<std::mutex> lock(run->mutex);
+	run->cancelled = true;
+	if (run->colony != nullptr) { run->colony->cancel(); }
+}
+
+bool SolveHandle::wait_for(std::chrono::steady_clock::duration timeout) {
+	std::unique_lock<std::mutex> lock(run->mutex);
+	return run->finish_line.wait_for(lock, timeout, [&] { return run->finished; });
+}
+
+SolveResult SolveHandle::result() {
+	std::unique_lock<std::mutex> lock(run->mutex);
+	run->finish_line.wait(lock, [&] { return run->finished; });
+	return run->outcome;
+}
+
+std::unique_ptr<SolveHandle> start(const SolverInstance& instance, SolveOptions options) {
+	register_colonies();
+	auto run = std::make_unique<SolveHandle::Run>(instance, std::move(options));
+	SolveHandle::Run& started = *run;
+	started.thread = std::thread([&started] { started.run(); });
+	return std::make_unique<SolveHandle>(std::move(run));
+}
+
+SolveResult solve(const SolverInstance& instance, const SolveOptions& options) {
+	return start(instance, options)->result();
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+	In-process solver API, `make library` builds it with the colonies into libantopt.a (no GUI dependencies).
+	See antopt.h for the same in plain C.
+*/
+
+/*
+	Explicit SOP instance owned by the caller. The arrays are read in place, they have to stay valid
+	and unchanged until `solve` returns (or the handle of `start` is destroyed). Node 0 is the start, node dimension - 1 the goal.
+
+	Memory of a run besides the arrays: the arcs are indexed once in CSR form (4 bytes per arc, twice: problem and colony),
+	the colony keeps 12 bytes per arc (per node pair if at least 75% of them are arcs) and every ant (one per node)
+	an int per node, so about 4 * dimension² bytes for all ants.
+*/
+struct SolverInstance {
+	int32_t dimension = 0;
+	/*
+		Row major dimension x dimension matrix, weights[from * dimension + to].
+		-1 where there is no arc (diagonal, arcs against a precedence), INT32_MAX for arcs no ant may take.
+		Unlike .sop files the matrix does not encode precedences, they come from the lists below.
+	*/
+	const int32_t* weights = nullptr;
+	/*
+		Precedences in CSR form, the nodes that have to come after `node` are
+			precedence[precedence_offsets[node]] .. precedence[precedence_offsets[node + 1]]
+		`precedence_offsets` has dimension + 1 entries
+	*/
+	const int32_t* precedence_offsets = nullptr;
+	const int32_t* precedence = nullptr;
+};
+
+struct SolveProgress {
+	// Rounds finished
+	int round;
+	double elapsed_ms;
+	int best_length;
+	const std::vector<int32_t>& best_route;
+};
+
+struct SolveOptions {
+	// Colony spec as for -t, e.g. `acs:4`
+	std::string colony = "serial";
+	std::string update = "iteration-best";
+	// Budget, the run stops at whichever is reached first. 0 seconds: no time limit
+	int rounds = 100;
+	double seconds = 0;
+	bool seeded = false;
+	unsigned int seed = 0;
+	/*
+		Called on the solving thread after every round that improved the best route (and once for the first).
+		Return false to stop the run.
+	*/
+	std::function<bool(const SolveProgress&)> progress;
+};
+
+struct SolveResult {
+	// -1 if no route was found or the request was invalid (see `error`)
+	int length = -1;
+	std::vector<int32_t> route;
+	int rounds = 0;
+	double elapsed_ms = 0;
+	// Empty on success
+	std::string error;
+};
+
+/*
+	A colony running on its own thread, see `start`. Every method may be called from any thread.
+	Destroying the handle cancels the run and waits for it.
+*/
+class SolveHandle {
+public:
+	struct Run;
+
+	explicit SolveHandle(std::unique_ptr<Run> run);
+	~SolveHandle();
+
+	/*
+		The run as it stands: best route so far (length -1 before the first), rounds finished and time since `start`.
+		Lock free, the route is copied out of a seqlock the solving thread publishes every improvement to.
+	*/
+	SolveResult best_so_far() const;
+
+	// Rounds finished
+	int round() const;
+
+	// Stops the run before its next ant, the round in progress is dropped
+	void cancel();
+
+	// True once the run ended within `timeout`
+	bool wait_for(std::chrono::steady_clock::duration timeout);
+
+	// Waits for the end of the run
+	SolveResult result();
+private:
+	std::unique_ptr<Run> run;
+};
+
+/*
+	Starts one colony on `instance` and returns at once. Setup happens on the solving thread,
+	problems with the instance or options end the run with `SolveResult::error` set. Never exits the process.
+*/
+std::unique_ptr<SolveHandle> start(const SolverInstance& instance, SolveOptions options);
+
+/*
+	`start` and wait for the result. Safe to call from several threads at once.
+*/
+SolveResult solve(const SolverInstance& instance, const SolveOptions& options);
+
+// Names of the registered colonies
+std::vector<std::string> solver_colonies();
@@ -1,25 +1,99 @@
-#include "colonies/serial.hpp"
-#include "colonies/parallel.hpp"
-#include "colonies/batched.hpp"
-#include "colonies/threaded.hpp"
+#include "colonies/registry.hpp"
 
 #include "problem.hpp"
+#include "heuristic.hpp"
+#include "report.hpp"
+#include "bench.hpp"
+#include "batch.hpp"
+#include "generator.hpp"
+#include "daemon.hpp"
 #include "workspace.hpp"
 
 #include <chrono>
 #include <filesystem>
 #include <memory>
 #include <string>
+#include <thread>
 
 struct CliParams {
 	std::string colony_identifier = "serial";
+	std::string update_identifier = "iteration-best";
 	bool interactive = false;
 	bool profiler = false;
 	bool csv_profiler = false;
 	bool verbose = false;
 	bool list = false;
+	bool bench = false;
+	bool ttt = false;
+	bool scaling = false;
+	bool batch = false;
+	int max_threads = std::max(1u, std::thread::hardware_concurrency());
+	std::filesystem::path compare_path;
+	float threshold = 0.05;
+	float alpha = 0.01;
+	bool perf_counters = false;
+	bool mem_report = false;
+	int neighbours = Problem::default_neighbours;
 	int rounds = 100;
 	std::filesystem::path problem_path;
+	std::filesystem::path generate_path;
+	GeneratorConfig generator;
+	std::filesystem::path daemon_socket;
+	int cache_size = 16;
+	std::filesystem::path init_tour_path;
+	float init_strength = 0.5;
+
+	// Every -t, -r, -s and FILE given, used by modes running more than one configuration
+	std::vector<std::string> colony_identifiers;
+	std::vector<int> round_counts;
+	std::vector<unsigned int> seeds;
+	std::vector<std::filesystem::path> problem_paths;
+
+	int warmup = 1;
+	int trials = 3;
+	float target_gap = 0.05;
+	std::vector<float> target_gaps;
+	std::filesystem::path output_path;
+	std::filesystem::path convergence_path;
+	std::filesystem::path trace_path;
+	std::filesystem::path checkpoint_path;
+	std::filesystem::path resume_path;
+	int checkpoint_every = 100;
+	// False if the rounds are the default, a resumed run then finishes the rounds it was started with
+	bool rounds_given = false;
+	int convergence_every = 0;
+
+	static std::string next_arg(int argc, char* argv[], int& i, const char* what) {
+		std::string arg = argv[i];
+		i++;
+		if (i >= argc) {
+			std::cout << "No " << what << " given for " << arg << " parameter" << std::endl;
+			exit(1);
+		}
+		return argv[i];
+	}
+
+	static int next_int(int argc, char* argv[], int& i) {
+		std::string value = next_arg(argc, argv, i, "count");
+		try {
+			return std::stoi(value);
+		}
+		catch(const std::invalid_argument& e) {
+			std::cout << "No valid integer: " << value << std::endl;
+			exit(1);
+		}
+	}
+
+	static float next_float(int argc, char* argv[], int& i) {
+		std::string value = next_arg(argc, argv, i, "value");
+		try {
+			return std::stof(value);
+		}
+		catch(const std::invalid_argument& e) {
+			std::cout << "No valid number: " << value << std::endl;
+			exit(1);
+		}
+	}
 
 	CliParams(int argc, char* argv[]) {
 		for (int i = 1; i < argc; i++) {
@@ -36,14 +110,13 @@ struct CliParams {
 			}
 
 			if (arg == "-t" || arg == "--type") {
-				i++;
-				if (i >= argc) {
-					std::cout << "No name given for " << arg << " parameter" << std::endl;
-					exit(1);
-				}
-				
-				colony_identifier = argv[i];
+				colony_identifier = next_arg(argc, argv, i, "name");
+				colony_identifiers.push_back(colony_identifier);
+				continue;
+			}
 
+			if (arg == "-u" || arg == "--update") {
+				update_identifier = next_arg(argc, argv, i, "name");
 				continue;
 			}
 
@@ -63,19 +136,192 @@ struct CliParams {
 			}
 
 			if (arg == "-r" || arg == "--rounds") {
-				i++;
-				if (i >= argc) {
-					std::cout << "No count given for " << arg << " parameter" << std::endl;
+				rounds = std::max(1, next_int(argc, argv, i));
+				round_counts.push_back(rounds);
+				continue;
+			}
+
+			if (arg == "-s" || arg == "--seed") {
+				seeds.push_back(static_cast<unsigned int>(next_int(argc, argv, i)));
+				continue;
+			}
+
+			if (arg == "--perf-counters") {
+				perf_counters = true;
+				continue;
+			}
+
+			if (arg == "--edges") {
+				std::string name = next_arg(argc, argv, i, "storage");
+				if (!AntOptimizer::parse_edge_storage(name, AntOptimizer::edge_storage)) {
+					std::cout << "Unknown edge storage: " << name << std::endl;
 					exit(1);
 				}
-				try {
-					rounds = std::stoi(argv[i]);
+				continue;
+			}
+
+			if (arg == "--neighbours") {
+				neighbours = std::max(1, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--init-tour") {
+				init_tour_path = next_arg(argc, argv, i, "path");
+				continue;
+			}
+
+			if (arg == "--init-strength") {
+				init_strength = std::clamp(next_float(argc, argv, i), 0.0f, 1.0f);
+				continue;
+			}
+
+			if (arg == "--daemon") {
+				daemon_socket = next_arg(argc, argv, i, "socket");
+				continue;
+			}
+
+			if (arg == "--cache-size") {
+				cache_size = std::max(1, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--generate") {
+				generate_path = next_arg(argc, argv, i, "path");
+				continue;
+			}
+
+			if (arg == "--nodes") {
+				generator.nodes = next_int(argc, argv, i);
+				continue;
+			}
+
+			if (arg == "--weights") {
+				std::string name = next_arg(argc, argv, i, "distribution");
+				if (!parse_generator_weights(name, generator.weights)) {
+					std::cout << "Unknown weight distribution: " << name << std::endl;
+					exit(1);
 				}
-				catch(const std::invalid_argument& e) {
-					std::cout << "No valid integer: " << argv[i] << std::endl;
+				continue;
+			}
+
+			if (arg == "--max-weight") {
+				generator.max_weight = next_int(argc, argv, i);
+				continue;
+			}
+
+			if (arg == "--precedence-density") {
+				generator.precedence_density = std::max(0.0f, next_float(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--structure") {
+				std::string name = next_arg(argc, argv, i, "structure");
+				if (!parse_generator_structure(name, generator.structure)) {
+					std::cout << "Unknown precedence structure: " << name << std::endl;
 					exit(1);
 				}
-				
+				continue;
+			}
+
+			if (arg == "--coordinates") {
+				generator.coordinates = true;
+				continue;
+			}
+
+			if (arg == "--mem-report") {
+				mem_report = true;
+				continue;
+			}
+
+			if (arg == "-b" || arg == "--bench") {
+				bench = true;
+				continue;
+			}
+
+			if (arg == "--compare") {
+				compare_path = next_arg(argc, argv, i, "path");
+				bench = true;
+				continue;
+			}
+
+			if (arg == "--threshold") {
+				threshold = next_float(argc, argv, i);
+				continue;
+			}
+
+			if (arg == "--alpha") {
+				alpha = next_float(argc, argv, i);
+				continue;
+			}
+
+			if (arg == "--scaling") {
+				scaling = true;
+				continue;
+			}
+
+			if (arg == "--batch") {
+				batch = true;
+				continue;
+			}
+
+			if (arg == "--max-threads") {
+				max_threads = std::max(1, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--ttt") {
+				ttt = true;
+				continue;
+			}
+
+			if (arg == "--trace") {
+				trace_path = next_arg(argc, argv, i, "path");
+				continue;
+			}
+
+			if (arg == "--checkpoint") {
+				checkpoint_path = next_arg(argc, argv, i, "path");
+				continue;
+			}
+
+			if (arg == "--checkpoint-every") {
+				checkpoint_every = std::max(0, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--resume") {
+				resume_path = next_arg(argc, argv, i, "path");
+				continue;
+			}
+
+			if (arg == "--convergence") {
+				convergence_path = next_arg(argc, argv, i, "path");
+				continue;
+			}
+
+			if (arg == "--convergence-every") {
+				convergence_every = std::max(0, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--warmup") {
+				warmup = std::max(0, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--trials") {
+				trials = std::max(1, next_int(argc, argv, i));
+				continue;
+			}
+
+			if (arg == "--target-gap") {
+				target_gap = next_float(argc, argv, i);
+				target_gaps.push_back(target_gap);
+				continue;
+			}
+
+			if (arg == "-o" || arg == "--output") {
+				output_path = next_arg(argc, argv, i, "path");
 				continue;
 			}
 
@@ -83,17 +329,72 @@ struct CliParams {
 				std::cout
 				<< "Ant Optimizer\n"
 				<< "Usage: ./main [OPTIONS] FILE\n"
+				<< "       ./main --bench [OPTIONS] FILE...\n"
+				<< "       ./main --batch [OPTIONS] FILE|DIR|MANIFEST...\n"
+				<< "       ./main --generate FILE [GENERATOR OPTIONS]\n"
+				<< "       ./main --daemon SOCKET [--max-threads N] [--cache-size N]\n"
 				<< "\n"
 				<< "Options:\n"
 				<< "  -i    --interactive   : Start with GUI and manual control\n"
 				<< "  -v    --verbose       : Output information about colony. Enabled by default in interactive mode\n"
-				<< "  -t    --type          : Specify other colony implementation. Default: serial \n"
-				<< "  -l    --list          : List types of colony implementations \n"
+				<< "  -t    --type          : Specify other colony implementation. Repeat to run several. Default: serial \n"
+				<< "  -l    --list          : List types of colony implementations and update strategies \n"
+				<< "  -u    --update        : Specify pheromone update strategy of Max-Min colonies. Default: iteration-best \n"
 				<< "  -p    --profiler      : Append results to file. Location: <problem_folder>/profiler/<problem_name>_<implementation_name>.txt\n"
 				<< "  -c    --csv-profiler  : Append result to file. Location: <problem_folder/csv-profiler/problem_name>.csv\n"
 				<< "  -r N  --rounds N      : Do N optimization steps. Requires [SHIFT] in interactive mode. Default: 100\n"
+				<< "  -s N  --seed N        : Seed the ants for reproducible runs. Default: random\n"
+				<< "        --perf-counters : Count cycles, cache misses, ... per thread (Linux). Reported by -p, -c and -v\n"
+				<< "        --neighbours K  : Neighbour list length of NODE_COORD_SECTION instances. Default: 16\n"
+				<< "        --edges S       : Per-edge storage of the colonies: dense, sparse (CSR, no forbidden arcs) or auto by arc density. Default: auto\n"
+				<< "        --mem-report    : Print the bytes of every structure of the problem and each colony, and each colony's peak RSS\n"
+				<< "        --trace P       : Write a timeline of every thread's phases to P (Chrome trace format, open in ui.perfetto.dev)\n"
+				<< "        --checkpoint P  : Save the colony's state to P every --checkpoint-every rounds (default: 100) and on SIGTERM\n"
+				<< "        --resume P      : Continue the run saved in checkpoint P (colony and update strategy are taken from it).\n"
+				<< "                          -r counts rounds including those already done. Keeps checkpointing to P\n"
+				<< "        --init-tour P   : Start from the tour in P (TSPLIB .tour or 0 based nodes as printed by -v) as best route\n"
+				<< "        --init-strength S : Share (0-1) of the way the initial trails move towards the tour. Default: 0.5\n"
+				<< "        --convergence P : Append round, time, iteration best, best and lost ants to CSV file P on improvements\n"
+				<< "        --convergence-every K : Also append every K rounds\n"
 				<< "  -h    --help          : Show this help page\n"
 				<< "\n"
+				<< "Benchmark mode:\n"
+				<< "  -b    --bench         : Run every FILE with every -t, -s and -r given\n"
+				<< "        --warmup N      : Discarded runs per configuration. Default: 1\n"
+				<< "        --trials N      : Measured runs per configuration. Default: 3\n"
+				<< "        --target-gap G  : Time-to-target measures reaching best known * (1 + G). Default: 0.05\n"
+				<< "  -o P  --output P      : Write results to P.json and P.csv. Default: <problem_folder>/profiler/bench_<timestamp>\n"
+				<< "        --compare B     : Rerun every cell of baseline B (a bench .csv) and test for slowdowns.\n"
+				<< "                          FILEs override where problems are found. Exits with 3 on regressions\n"
+				<< "        --threshold T   : Slowdown of the median that counts as regression. Default: 0.05\n"
+				<< "        --alpha A       : Significance level of the Mann-Whitney U test on round times. Default: 0.01\n"
+				<< "        --ttt           : Time-to-target distributions instead: one run per -s (default: 1-10), every --target-gap\n"
+				<< "                          Writes P.csv. Default: <problem_folder>/profiler/ttt_<timestamp>\n"
+				<< "        --scaling       : Thread scaling sweep instead: threaded:1..N and batched:<ants>..1 with every -s (default: 1-3)\n"
+				<< "                          Reports speedup, efficiency and Karp-Flatt serial fraction. Writes P.csv\n"
+				<< "        --max-threads N : Largest thread count of the sweep. Default: hardware concurrency\n"
+				<< "\n"
+				<< "Batch mode:\n"
+				<< "        --batch         : Run every problem with every -t, -s (default: 1) and -r in one process. Jobs run at once while their\n"
+				<< "                          colonies' threads fit into --max-threads (admission control, colonies still start their own threads).\n"
+				<< "                          FILEs may be directories (their .sop files) or .txt manifests (one path per line).\n"
+				<< "                          `auto` in -t uses a thread per 100 nodes, larger counts are lowered to --max-threads. Writes P.json and P.csv. Default: <problem_folder>/profiler/batch_<timestamp>\n"
+				<< "\n"
+				<< "Daemon mode:\n"
+				<< "        --daemon P      : Serve solve requests on Unix socket P until SIGTERM, see src/daemon.hpp for the protocol.\n"
+				<< "                          Serves --max-threads connections at once. A run waits until its colony's threads fit into\n"
+				<< "                          --max-threads slots like in --batch, colonies still start their own threads\n"
+				<< "        --cache-size N  : Parsed instances kept in memory, keyed by a hash of their text. Default: 16\n"
+				<< "\n"
+				<< "Generator:\n"
+				<< "        --generate P    : Write a synthetic instance to P, seeded by -s (default: 1)\n"
+				<< "        --nodes N       : Nodes including start and goal, at most 50000. Default: 1000\n"
+				<< "        --weights W     : uniform, normal or euclidean. Default: uniform\n"
+				<< "        --max-weight W  : Largest weight (side of the square for euclidean). Default: 1000\n"
+				<< "        --precedence-density D : Average direct predecessors per node (at most 1 for chains). Default: 0.5\n"
+				<< "        --structure S   : chains, layered or random. Default: random\n"
+				<< "        --coordinates   : Write NODE_COORD_SECTION and PRECEDENCE_SECTION instead of the N² matrix (euclidean only)\n"
+				<< "\n"
 				<< "Interactive mode shortcuts:\n"
 				<< "  [L MOUSE BTN]   Drag node plane \n"
 				<< "  [MOUSE WHEEL]   Zoom node plane \n"
@@ -107,10 +408,36 @@ struct CliParams {
 				exit(0);
 			}
 
-			problem_path = arg;
+			problem_paths.push_back(arg);
+		}
+
+		if (!problem_paths.empty()) {
+			problem_path = problem_paths.back();
+		}
+		rounds_given = !round_counts.empty();
+		if (colony_identifiers.empty()) {
+			colony_identifiers.push_back(colony_identifier);
+		}
+		if (round_counts.empty()) {
+			round_counts.push_back(rounds);
 		}
+	}
 
-		rounds = std::max(1, rounds);
+	/*
+		Colony specs of all -t options, `all` expanded
+	*/
+	std::vector<std::string> colony_options() const {
+		std::vector<std::string> options;
+		for (const auto& identifier : colony_identifiers) {
+			if (identifier == "all") {
+				auto all = all_colony_options();
+				options.insert(options.end(), all.begin(), all.end());
+			}
+			else {
+				options.push_back(identifier);
+			}
+		}
+		return options;
 	}
 };
 
@@ -179,7 +506,8 @@ Profiler run_colony(AntOptimizer& optimizer, int rounds = 1) {
 
 	auto tp2 = std::chrono::high_resolution_clock::now();
 	double elapsed = std::chrono::duration_cast<std::chrono::duration<double, std::milli>>(tp2 - tp1).count();
-	double avg = elapsed / rounds;
+	// Fewer rounds than asked for if stopped by SIGTERM
+	double avg = elapsed / std::max<size_t>(1, pf.rounds());
 
 	std::cout.precision(4);
 	std::cout
@@ -193,163 +521,320 @@ Profiler run_colony(AntOptimizer& optimizer, int rounds = 1) {
 	return pf;
 }
 
-struct AbstractColonyFactory {
-	virtual std::string name() const = 0;
-	virtual std::unique_ptr<AntOptimizer> make(const Problem& problem, const std::vector<Ant>& ants, Parameters params, std::string args) = 0;
-	virtual ~AbstractColonyFactory() = default;
-};
+int main(int argc, char* argv[]) {
+	init_colonies();
+	CliParams cli(argc, argv);
 
-template<typename Ty>
-struct ColonyFactory: AbstractColonyFactory {
-	std::string name() const override { return Ty::_name; }
+	if (cli.list) {
+		std::cout << "Colonies:\n";
+		for (const auto& e : colonies) {
+			std::cout << "  " << e->name() << '\n';
+		}
+		std::cout << "Update strategies:\n";
+		for (const auto& e : update_strategy_names()) {
+			std::cout << "  " << e << '\n';
+		}
+		return 0;
+	}
 
-	std::unique_ptr<AntOptimizer> make(const Problem& problem, const std::vector<Ant>& ants, Parameters params, std::string args) override {
-		auto e = std::make_unique<Ty>(problem.graph, problem.dependencies, problem.weights, ants, params);
-		e->init_args = args;
-		e->init(args);
-		return e;
+	if (!cli.daemon_socket.empty()) {
+		DaemonConfig config;
+		config.socket = cli.daemon_socket;
+		config.threads = cli.max_threads;
+		config.neighbours = cli.neighbours;
+		config.cache_size = cli.cache_size;
+		run_daemon(config);
+		return 0;
 	}
-};
 
-std::vector<std::unique_ptr<AbstractColonyFactory>> colonies;
-void init_colonies() {
-	#define add(CLASS) do { colonies.emplace_back(std::make_unique<ColonyFactory<CLASS>>()); } while(0)
+	if (!cli.generate_path.empty()) {
+		GeneratorConfig& generator = cli.generator;
+		generator.seed = cli.seeds.empty() ? 1 : cli.seeds.front();
+		if (generator.nodes < 3 || generator.nodes > GeneratorConfig::max_nodes) {
+			std::cout << "Nodes have to be between 3 and " << GeneratorConfig::max_nodes << std::endl;
+			exit(1);
+		}
+		if (generator.max_weight < 1 || generator.max_weight >= 1000000) {
+			std::cout << "Max weight has to be between 1 and 999999" << std::endl;
+			exit(1);
+		}
+		if (generator.coordinates && generator.weights != GeneratorConfig::Weights::euclidean) {
+			std::cout << "--coordinates needs --weights euclidean" << std::endl;
+			exit(1);
+		}
 
-	add(SerialAntOptimizer);
-	add(ParallelAntOptimizer);
-	add(BatchedAntOptimizer);
-	add(ThreadedAntOptimizer);
+		auto start = std::chrono::steady_clock::now();
+		int64_t precedences = generate_problem(generator, cli.generate_path);
+		if (precedences < 0) {
+			std::cout << "Could not write " << cli.generate_path.string() << std::endl;
+			exit(1);
+		}
+		double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-	#undef add
-}
+		std::cout.precision(4);
+		std::cout << "Wrote " << cli.generate_path.string() << ": " << generator.nodes << " nodes, " << precedences << " precedences, "
+			<< print_bytes(std::filesystem::file_size(cli.generate_path)) << " in " << elapsed << "s" << std::endl;
+		return 0;
+	}
 
-std::unique_ptr<AntOptimizer> makeColony(const std::string& colony_constructor, const Problem& problem, std::vector<Ant>& ants, Parameters params) {
-	auto sep = colony_constructor.find_first_of(":");
-	const std::string identifier = colony_constructor.substr(0, sep);
-	const std::string args = (sep != std::string::npos ? colony_constructor.substr(sep + 1) : "");
+	if (cli.bench || cli.ttt || cli.scaling || cli.batch) {
+		if (!cli.init_tour_path.empty()) {
+			std::cout << "--init-tour only works for single runs" << std::endl;
+			exit(1);
+		}
 
-	auto it = std::find_if(colonies.begin(), colonies.end(), [&](const std::unique_ptr<AbstractColonyFactory>& e){ return e->name() == identifier; });
+		BenchConfig config;
+		config.problems = cli.batch ? batch_problems(cli.problem_paths) : cli.problem_paths;
+		config.colonies = cli.colony_options();
+		config.seeds = cli.seeds;
+		if (config.seeds.empty()) {
+			config.seeds = cli.ttt ? std::vector<unsigned int>{ 1, 2, 3, 4, 5, 6, 7, 8, 9, 10 }
+				: cli.scaling ? std::vector<unsigned int>{ 1, 2, 3 }
+				: std::vector<unsigned int>{ 1 };
+		}
+		config.rounds = cli.round_counts;
+		config.update = cli.update_identifier;
+		config.warmup = cli.warmup;
+		config.trials = cli.trials;
+		config.target_gap = cli.target_gap;
+		config.target_gaps = cli.target_gaps;
+		config.output = cli.output_path;
+		config.convergence = cli.convergence_path;
+		config.convergence_every = cli.convergence_every;
+
+		if (config.problems.empty() && cli.compare_path.empty()) {
+			std::cout << "No problem files given" << std::endl;
+			exit(1);
+		}
 
-	if (it == colonies.end()) {
-		std::cout << "Unknown colony: " << identifier << std::endl;
-		exit(1);
-	}
+		if (config.output.empty()) {
+			std::string now = print_now();
+			std::replace(now.begin(), now.end(), ':', '-');
+			std::filesystem::path folder = config.problems.empty() ? cli.compare_path.parent_path() : config.problems.front().parent_path() / "profiler";
+			config.output = folder / ((cli.ttt ? "ttt_" : cli.scaling ? "scaling_" : cli.batch ? "batch_" : "bench_") + now);
+		}
+		if (config.output.has_parent_path()) {
+			std::filesystem::create_directories(config.output.parent_path());
+		}
 
-	return (*it)->make(problem, ants, params, args);
-}
+		if (cli.batch) {
+			auto start = std::chrono::steady_clock::now();
+			std::vector<BatchResult> results = run_batch(config, cli.max_threads, cli.neighbours);
+			double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			double busy = 0;
+			for (const auto& r : results) { busy += r.total * r.threads / 1000; }
+			std::cout.precision(4);
+			std::cout << results.size() << " jobs in " << elapsed << "s on " << cli.max_threads << " threads ("
+				<< (elapsed > 0 ? busy / (elapsed * cli.max_threads) * 100 : 0) << "% of the slots busy)" << std::endl;
+
+			write_batch_json(config.output.string() + ".json", config, cli.max_threads, results);
+			write_batch_csv(config.output.string() + ".csv", results);
+			std::cout << "Results written to " << config.output.string() << ".{json,csv}" << std::endl;
+			return 0;
+		}
 
-std::string print_duration(Profiler::Duration d, bool append_unit) {
-	return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(d).count()) + (append_unit ? " µs" : "");
-}
+		if (cli.scaling) {
+			std::vector<ScalingResult> results = run_scaling(config, cli.max_threads);
+			write_scaling_csv(config.output.string() + ".csv", results);
+			std::cout << "Results written to " << config.output.string() << ".csv" << std::endl;
+			return 0;
+		}
 
-std::string print_now() {
-	auto current_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-	char now_str[std::size("2000-01-01T16:00:00")];
-	std::strftime(now_str, std::size(now_str), "%FT%T", std::gmtime(&current_time));
-	return std::string(now_str);
-}
+		if (cli.ttt) {
+			std::vector<TttResult> results = run_time_to_target(config);
+			write_ttt_csv(config.output.string() + ".csv", results);
+			std::cout << "Results written to " << config.output.string() << ".csv" << std::endl;
+			return 0;
+		}
 
-std::string print_params(Parameters params) {
-	std::string result = "";
-	result += "alpha: " + std::to_string(params.alpha) + ", ";
-	result += "beta: " + std::to_string(params.beta) + ", ";
-	result += "roh: " + std::to_string(params.roh) + ", ";
-	result += "q: " + std::to_string(params.q) + ", ";
-	result += "initial_pheromone: " + std::to_string(params.initial_pheromone) + ", ";
-	result += "min_pheromone: " + std::to_string(params.min_pheromone) + ", ";
-	result += "max_pheromone: " + std::to_string(params.max_pheromone) + ", ";
-	result += "zero_distance: " + std::to_string(params.zero_distance);
-
-	return result;
-}
+		if (!cli.compare_path.empty()) {
+			std::vector<BenchResult> baseline = read_bench_csv(cli.compare_path);
+			std::vector<BenchResult> results;
+			std::vector<BenchComparison> comparisons = compare_bench(config, baseline, cli.compare_path, cli.threshold, cli.alpha, results);
 
-void append_profiler(std::filesystem::path path, const Profiler& pf, AntOptimizer* colony, const Problem& problem) {
-	std::ofstream file(path, std::ios::app);
-	auto mm = pf.min_max();
-	file 
-		<< "### " << print_now() << " ###\n"
-		<< "solution=" << colony->best_route.length << "\n"
-		<< "bounds=" << problem.bounds.first << ", " << problem.bounds.second << "\n"
-		<< "rounds=" << pf.durations.size() << "\n"
-		<< "total=" << print_duration(pf.total(), true) << "\n"
-		<< "avg=" << print_duration(pf.avg(), true) << "\n"
-		<< "min=" << print_duration(mm.first, true) << "\n"
-		<< "max=" << print_duration(mm.second, true) << "\n"
-		<< "params=" << print_params(colony->params) << "\n"
-		<< "args=" << colony->init_args << "\n"
-		<< "\n";
-}
+			write_bench_json(config.output.string() + ".json", config, results);
+			write_bench_csv(config.output.string() + ".csv", results);
+			std::cout << "Results written to " << config.output.string() << ".{json,csv}" << std::endl;
+
+			int regressions = std::count_if(comparisons.begin(), comparisons.end(), [](const BenchComparison& c) { return c.regression; });
+			std::cout << regressions << " of " << comparisons.size() << " configurations regressed" << std::endl;
+			if (comparisons.size() < baseline.size()) {
+				std::cout << baseline.size() - comparisons.size() << " baseline configurations could not be rerun" << std::endl;
+			}
+			return regressions > 0 ? 3 : 0;
+		}
 
-void append_csv_profiler(std::filesystem::path path, const Profiler& pf, AntOptimizer* colony, const Problem& problem) {
-	bool new_file = !std::filesystem::is_regular_file(path);
-	std::ofstream file(path, std::ios::app);
-	if (new_file) {
-		file << "timestamp;optimizer;rounds;total_µs;avg_µs;min_µs;max_µs;solution;bounds_min;bounds_max;" << "\n";
+		std::vector<BenchResult> results = run_bench(config);
+		write_bench_json(config.output.string() + ".json", config, results);
+		write_bench_csv(config.output.string() + ".csv", results);
+		std::cout << "Results written to " << config.output.string() << ".{json,csv}" << std::endl;
+
+		return 0;
 	}
 
-	auto mm = pf.min_max();
-	file
-		<< print_now() << ";"
-		<< colony->name() << ":" << colony->init_args << ";"
-		<< pf.durations.size() << ";"
-		<< print_duration(pf.total(), false) << ";"
-		<< print_duration(pf.avg(), false) << ";"
-		<< print_duration(mm.first, false) << ";"
-		<< print_duration(mm.second, false) << ";"
-		<< colony->best_route.length << ";"
-		<< problem.bounds.first << ";" << problem.bounds.second << ";";
-	file << "\n";
-}
+	Checkpoint resume;
+	if (!cli.resume_path.empty()) {
+		if (!read_checkpoint(cli.resume_path, resume)) {
+			std::cout << "No valid checkpoint: " << cli.resume_path.string() << std::endl;
+			exit(1);
+		}
+		cli.colony_identifiers = { resume.colony };
+		cli.update_identifier = resume.update;
+		if (!cli.rounds_given) {
+			cli.rounds = resume.rounds;
+		}
+		if (cli.checkpoint_path.empty()) {
+			cli.checkpoint_path = cli.resume_path;
+		}
+	}
 
-int main(int argc, char* argv[]) {
-	init_colonies();
-	CliParams cli(argc, argv);
+	if (!cli.resume_path.empty() && !cli.init_tour_path.empty()) {
+		std::cout << "A resumed run continues from its checkpoint, --init-tour can not be used" << std::endl;
+		exit(1);
+	}
 
-	if (cli.list) {
-		for (const auto& e : colonies) {
-			std::cout << e->name() << '\n';
+	if (!cli.checkpoint_path.empty()) {
+		if (cli.interactive || cli.colony_options().size() != 1) {
+			std::cout << "Checkpoints need exactly one colony (-t) and no interactive mode" << std::endl;
+			exit(1);
 		}
-		return 0;
+		install_termination_handler();
 	}
 
 	if (!std::filesystem::exists(cli.problem_path)) {
 		std::cout << "File '" << cli.problem_path << "' does not exist";
 		exit(1);
 	}
-	Problem problem(cli.problem_path);
+	Problem problem(cli.problem_path, cli.neighbours);
+
+	if (!cli.resume_path.empty() && resume.problem != problem.name) {
+		std::cout << "Checkpoint belongs to problem " << resume.problem << ", not " << problem.name << std::endl;
+		exit(1);
+	}
+
+	std::shared_ptr<UpdateStrategy> update_strategy = make_update_strategy(cli.update_identifier);
+	if (update_strategy == nullptr) {
+		std::cout << "Invalid update strategy: " << cli.update_identifier << std::endl;
+		exit(1);
+	}
 	
-	std::vector<Ant> ants;
-	ants.resize(problem.graph.node_count(), Ant(0));
+	if (cli.perf_counters) {
+		std::string reason;
+		if (!PerfCounters::supported(reason)) {
+			std::cout << "Performance counters unavailable: " << reason << ". Continuing without hardware events" << std::endl;
+		}
+	}
 
-	int max_dist = 0;
-	for (const auto & e : problem.weights) {
-		if (e.second == std::numeric_limits<int>::max()) { continue; }
-		max_dist = std::max(e.second, max_dist);
+	std::vector<Ant> ants;
+	ants.resize(default_ant_count(problem), Ant(0));
+
+	Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+	Route initial_tour;
+	if (!cli.init_tour_path.empty()) {
+		std::string error;
+		initial_tour = read_tour(cli.init_tour_path, problem, error);
+		if (initial_tour.length < 0) {
+			std::cout << "Can not start from " << cli.init_tour_path.string() << ": " << error << std::endl;
+			exit(1);
+		}
+	}
+	// Pheromone bounds follow the best route known
+	const bool tour_better = initial_tour.length >= 0 && (initial_route.length < 0 || initial_tour.length < initial_route.length);
+	Parameters params = default_parameters(problem, tour_better ? initial_tour : initial_route);
+
+	if (cli.verbose) {
+		std::cout << "Nearest neighbour route: " << (initial_route.length != -1 ? std::to_string(initial_route.length) : "None") << "\n";
+		if (initial_tour.length >= 0) {
+			std::cout << "Initial tour: " << initial_tour.length << "\n";
+		}
+		std::cout << "Parameters: " << print_params(params) << std::endl;
 	}
 
-	Parameters params;
-	params.initial_pheromone = 0.01;
-	params.alpha = 1.0;
-	params.beta = 0.5;
-	params.roh = 0.25;
-	params.q = max_dist;
-	params.min_pheromone = 0.01;
-	params.max_pheromone = 100;
-	params.zero_distance = 0.1;
+	if (cli.mem_report) {
+		std::cout << "Memory of problem:\n" << print_memory(problem_memory_usage(problem)) << std::flush;
+	}
 
 	if (!cli.interactive) {
-		std::vector<std::string> colony_options = {
-			"serial", "parallel", "batched:1", "batched:15", "threaded:auto", "threaded:4"
-		};
-
-		if (cli.colony_identifier != "all") {
-			colony_options.clear();
-			colony_options.push_back(cli.colony_identifier);
+		std::unique_ptr<TraceRecorder> trace;
+		if (!cli.trace_path.empty()) {
+			trace = std::make_unique<TraceRecorder>();
 		}
 
-		for (const auto & option : colony_options) {
+		for (const auto & option : cli.colony_options()) {
+			// Peak RSS of this colony only, including its construction
+			const size_t rss_before = current_rss();
+			const bool peak_reset = cli.mem_report && reset_peak_rss();
+
 			std::unique_ptr<AntOptimizer> colony = makeColony(option, problem, ants, params);
-			Profiler pf = run_colony(*colony, cli.rounds);
+			colony->update_best_route(initial_route);
+			if (initial_tour.length >= 0) {
+				colony->warm_start(initial_tour, cli.init_strength);
+			}
+			colony->set_update_strategy(update_strategy);
+			if (!cli.seeds.empty()) {
+				colony->seed(cli.seeds.front());
+			}
+			colony->perf_counters = cli.perf_counters;
+			colony->trace = trace.get();
+
+			std::unique_ptr<ConvergenceWriter> convergence;
+			if (!cli.convergence_path.empty()) {
+				std::string run = colony->name() + ":" + colony->init_args + ":" + (cli.seeds.empty() ? "random" : std::to_string(cli.seeds.front()));
+				convergence = std::make_unique<ConvergenceWriter>(cli.convergence_path, run);
+				colony->convergence = convergence.get();
+				colony->convergence_every = cli.convergence_every;
+			}
+
+			std::unique_ptr<CheckpointWriter> checkpoint;
+			int rounds = cli.rounds;
+			if (!cli.checkpoint_path.empty()) {
+				checkpoint = std::make_unique<CheckpointWriter>(cli.checkpoint_path, problem.name, cli.update_identifier, cli.rounds);
+				colony->checkpoint = checkpoint.get();
+				colony->checkpoint_every = cli.checkpoint_every;
+			}
+			if (!cli.resume_path.empty()) {
+				std::string error;
+				if (!colony->restore(resume, error)) {
+					std::cout << "Can not resume from " << cli.resume_path.string() << ": " << error << std::endl;
+					exit(1);
+				}
+				rounds = std::max(0, cli.rounds - colony->rounds_done);
+				std::cout << "Resuming after round " << colony->rounds_done << " (best: " << colony->best_route.length << ")" << std::endl;
+			}
+
+			Profiler pf = run_colony(*colony, rounds);
+
+			if (checkpoint != nullptr) {
+				// Final state, resuming a finished run does nothing
+				if (!termination_requested()) {
+					checkpoint->submit(colony->snapshot());
+				}
+				checkpoint->flush();
+				if (checkpoint->failed() > 0) {
+					std::cout << "Could not write " << checkpoint->failed() << " checkpoints to " << cli.checkpoint_path.string() << std::endl;
+				}
+				if (termination_requested()) {
+					std::cout << "Stopped after round " << colony->rounds_done << ", continue with --resume " << cli.checkpoint_path.string() << std::endl;
+					return 143;
+				}
+			}
+			if (convergence != nullptr && convergence->dropped() > 0) {
+				std::cout << "Convergence trace dropped " << convergence->dropped() << " rounds" << std::endl;
+			}
+
+			if (cli.mem_report) {
+				MemoryReport report;
+				colony->memory_usage(report);
+				std::cout << "Memory of " << colony->name() << (colony->init_args.empty() ? "" : ":" + colony->init_args) << ":\n" << print_memory(report);
+
+				const size_t peak = peak_rss();
+				std::cout << "  peak RSS" << (peak_reset ? "" : " (process)") << ": " << print_bytes(peak);
+				if (peak_reset && rss_before > 0 && peak > rss_before) {
+					std::cout << " (+" << print_bytes(peak - rss_before) << " over start)";
+				}
+				std::cout << std::endl;
+			}
 
 			if (cli.profiler) {
 				auto profile = cli.problem_path.parent_path() / "profiler" / (cli.problem_path.stem().string() + "_" + colony->name() + ".txt");
@@ -364,15 +849,32 @@ int main(int argc, char* argv[]) {
 			}
 
 			if (cli.verbose) {
+				std::cout << "Phases: " << print_phases(pf.phase_total()) << "\n";
+				if (!pf.counters.empty()) {
+					std::cout << "Counters: " << print_counters(pf.counter_total()) << "\n";
+				}
 				print_optimizer(*colony, problem);
 			}	
 		}
 
+		if (trace != nullptr) {
+			trace->write(cli.trace_path);
+			std::cout << "Trace written to " << cli.trace_path.string() << std::endl;
+		}
+
 		return 0;
 	}
 
 	std::unique_ptr<AntOptimizer> colony = makeColony(cli.colony_identifier, problem, ants, params);
-	Workspace workspace(2, problem.graph);
+	colony->update_best_route(initial_route);
+	if (initial_tour.length >= 0) {
+		colony->warm_start(initial_tour, cli.init_strength);
+	}
+	colony->set_update_strategy(update_strategy);
+	if (!cli.seeds.empty()) {
+		colony->seed(cli.seeds.front());
+	}
+	Workspace workspace(2, problem.graph_sets());
 
 	workspace.edge_color = [&colony](graph::Edge edge) {
 		float val = colony->pheromone(edge) / colony->minmax_pheromone().second;
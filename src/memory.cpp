@@ -0,0 +1,52 @@
+#include <fstream>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "memory.hpp"
+
+namespace {
+	// Value of `key` in /proc/self/status in bytes, 0 if missing
+	size_t proc_status_bytes(const std::string& key) {
+		std::ifstream status("/proc/self/status");
+		for (std::string line; std::getline(status, line);) {
+			if (line.rfind(key + ":", 0) == 0) {
+				return std::stoull(line.substr(key.size() + 1)) * 1024;
+			}
+		}
+		return 0;
+	}
+}
+
+bool reset_peak_rss() {
+#ifdef __linux__
+	// "5" resets VmHWM, see proc(5)
+	std::ofstream clear_refs("/proc/self/clear_refs");
+	clear_refs << "5";
+	clear_refs.flush();
+	return clear_refs.good();
+#else
+	return false;
+#endif
+}
+
+size_t peak_rss() {
+#ifdef __linux__
+	if (size_t bytes = proc_status_bytes("VmHWM")) { return bytes; }
+#endif
+	rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) { return 0; }
+#ifdef __APPLE__
+	return usage.ru_maxrss;
+#else
+	return usage.ru_maxrss * size_t(1024);
+#endif
+}
+
+size_t current_rss() {
+#ifdef __linux__
+	return proc_status_bytes("VmRSS");
+#else
+	return 0;
+#endif
+}
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+	Bytes currently and at most allocated through CountingAllocators pointing to this counter
+*/
+struct MemoryCounter {
+	std::atomic<int64_t> bytes{ 0 };
+	std::atomic<int64_t> peak{ 0 };
+	std::atomic<int64_t> allocations{ 0 };
+
+	void add(int64_t n) {
+		int64_t now = bytes.fetch_add(n, std::memory_order_relaxed) + n;
+		int64_t old_peak = peak.load(std::memory_order_relaxed);
+		while (now > old_peak && !peak.compare_exchange_weak(old_peak, now, std::memory_order_relaxed)) {}
+		allocations.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	void remove(int64_t n) {
+		bytes.fetch_sub(n, std::memory_order_relaxed);
+	}
+};
+
+/*
+	Counter new CountingAllocators of this thread charge, see MemoryScope.
+	Defaults to one process wide counter.
+*/
+inline MemoryCounter*& active_memory_counter() {
+	static MemoryCounter global;
+	thread_local MemoryCounter* active = &global;
+	return active;
+}
+
+/*
+	Charges all containers created (or copied) on this thread while the scope lives to `counter`
+*/
+class MemoryScope {
+private:
+	MemoryCounter* previous;
+public:
+	explicit MemoryScope(MemoryCounter& counter) : previous(active_memory_counter()) {
+		active_memory_counter() = &counter;
+	}
+	~MemoryScope() {
+		active_memory_counter() = previous;
+	}
+	MemoryScope(const MemoryScope&) = delete;
+	MemoryScope& operator=(const MemoryScope&) = delete;
+};
+
+/*
+	std::allocator that reports every allocation to the counter active when the container was created.
+	The counter sticks to the container (and moves with it), so memory is always returned to
+	the counter it was taken from. Copies are charged to the counter active at the time of the copy.
+*/
+template <typename T>
+class CountingAllocator {
+public:
+	using value_type = T;
+	using propagate_on_container_copy_assignment = std::true_type;
+	using propagate_on_container_move_assignment = std::true_type;
+	using propagate_on_container_swap = std::true_type;
+
+	MemoryCounter* counter;
+
+	CountingAllocator() noexcept : counter(active_memory_counter()) {}
+
+	template <typename U>
+	CountingAllocator(const CountingAllocator<U>& other) noexcept : counter(other.counter) {}
+
+	T* allocate(size_t n) {
+		counter->add(n * sizeof(T));
+		return std::allocator<T>().allocate(n);
+	}
+
+	void deallocate(T* p, size_t n) noexcept {
+		counter->remove(n * sizeof(T));
+		std::allocator<T>().deallocate(p, n);
+	}
+
+	CountingAllocator select_on_container_copy_construction() const {
+		return CountingAllocator();
+	}
+
+	template <typename U>
+	bool operator==(const CountingAllocator<U>& other) const { return counter == other.counter; }
+	template <typename U>
+	bool operator!=(const CountingAllocator<U>& other) const { return counter != other.counter; }
+};
+
+/*
+	Heap bytes of a vector of trivial elements
+*/
+template <typename T>
+size_t vector_bytes(const std::vector<T>& vector) {
+	return vector.capacity() * sizeof(T);
+}
+
+/*
+	Named byte counts, in the order they were added
+*/
+struct MemoryReport {
+	std::vector<std::pair<std::string, size_t>> entries;
+
+	void add(const std::string& name, size_t bytes) {
+		entries.emplace_back(name, bytes);
+	}
+
+	size_t total() const {
+		size_t sum = 0;
+		for (const auto& entry : entries) { sum += entry.second; }
+		return sum;
+	}
+};
+
+/*
+	Resets the peak resident set size of this process, so `peak_rss` covers only what follows.
+	Returns false if the system does not allow it (needs Linux >= 4.0), `peak_rss` then stays the process wide peak.
+*/
+bool reset_peak_rss();
+
+/*
+	Peak resident set size of this process in bytes, 0 if unknown
+*/
+size_t peak_rss();
+
+/*
+	Current resident set size of this process in bytes, 0 if unknown (Linux only)
+*/
+size_t current_rss();
@@ -0,0 +1,283 @@
+/*
+	Micro benchmark of the AntOptimizer kernels on a real instance.
+	Built separately from the GUI, see `make microbench`.
+
+	Usage: ./microbench [OPTIONS] FILE
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../problem.hpp"
+#include "../heuristic.hpp"
+#include "../colonies/base.hpp"
+
+namespace {
+	/*
+		Keeps the compiler from discarding `value` or hoisting its computation out of the loop
+	*/
+	template <typename T>
+	inline void do_not_optimize(const T& value) {
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	// Forces all pending writes to memory
+	inline void clobber_memory() {
+		asm volatile("" : : : "memory");
+	}
+
+	/*
+		Makes the protected kernels callable
+	*/
+	class KernelBench : public AntOptimizer {
+	public:
+		using AntOptimizer::AntOptimizer;
+		using AntOptimizer::edge_value;
+		using AntOptimizer::advance_ant;
+		using AntOptimizer::visit_node;
+		using AntOptimizer::route_length;
+		using AntOptimizer::evaporate_pheromone;
+		using AntOptimizer::update_edge_pheromone;
+		using AntOptimizer::edge_id;
+		using AntOptimizer::for_all_edges;
+		using AntOptimizer::sparse_edges;
+		using AntOptimizer::initial_ants;
+	};
+
+	struct Options {
+		std::string problem_path;
+		std::string kernel = "all";
+		double min_time_ms = 10;
+		int samples = 30;
+		unsigned int seed = 1;
+	};
+
+	struct Measurement {
+		std::string kernel;
+		size_t ops_per_sample;
+		std::vector<double> ns_per_op;
+	};
+
+	/*
+		`batch(ops)` runs (at least) `ops` operations and returns how many it did,
+		`setup` runs untimed before each batch.
+		The batch size is doubled until one batch takes `min_time_ms`, then `samples` batches are timed.
+	*/
+	Measurement measure(const std::string& kernel, const Options& options, const std::function<void(size_t)>& setup, const std::function<size_t(size_t)>& batch) {
+		using Clock = std::chrono::steady_clock;
+
+		auto run = [&](size_t ops) {
+			setup(ops);
+			clobber_memory();
+			auto t1 = Clock::now();
+			size_t done = batch(ops);
+			clobber_memory();
+			auto t2 = Clock::now();
+			return std::make_pair(std::chrono::duration<double, std::nano>(t2 - t1).count(), done);
+		};
+
+		size_t ops = 1;
+		while (run(ops).first < options.min_time_ms * 1e6 && ops < (size_t(1) << 40)) {
+			ops *= 2;
+		}
+
+		Measurement m{ kernel, ops, {} };
+		for (int i = 0; i < options.samples; i++) {
+			auto sample = run(ops);
+			m.ns_per_op.push_back(sample.first / sample.second);
+		}
+		return m;
+	}
+
+	void print(const Measurement& m) {
+		const size_t n = m.ns_per_op.size();
+		double mean = 0;
+		for (double v : m.ns_per_op) { mean += v; }
+		mean /= n;
+
+		double variance = 0;
+		for (double v : m.ns_per_op) { variance += (v - mean) * (v - mean); }
+		variance /= std::max<size_t>(1, n - 1);
+
+		std::vector<double> sorted = m.ns_per_op;
+		std::sort(sorted.begin(), sorted.end());
+
+		// Normal approximation, good enough for >= 30 samples
+		const double ci = 1.96 * std::sqrt(variance / n);
+
+		std::cout
+			<< std::left << std::setw(24) << m.kernel << std::right << std::fixed << std::setprecision(2)
+			<< std::setw(12) << mean << " ns/op"
+			<< "  ± " << std::setw(8) << ci << " (95% CI)"
+			<< "  median " << std::setw(10) << sorted[n / 2]
+			<< "  min " << std::setw(10) << sorted.front()
+			<< "  ops/sample " << m.ops_per_sample
+			<< "\n";
+	}
+
+	Options parse(int argc, char* argv[]) {
+		Options options;
+		for (int i = 1; i < argc; i++) {
+			std::string arg = argv[i];
+			auto next = [&]() {
+				if (++i >= argc) {
+					std::cout << "No value given for " << arg << std::endl;
+					exit(1);
+				}
+				return std::string(argv[i]);
+			};
+
+			if (arg == "-k" || arg == "--kernel") { options.kernel = next(); continue; }
+			if (arg == "--min-time") { options.min_time_ms = std::stod(next()); continue; }
+			if (arg == "--samples") { options.samples = std::max(2, std::stoi(next())); continue; }
+			if (arg == "-s" || arg == "--seed") { options.seed = std::stoul(next()); continue; }
+			if (arg == "--edges") {
+				std::string name = next();
+				if (!AntOptimizer::parse_edge_storage(name, AntOptimizer::edge_storage)) {
+					std::cout << "Unknown edge storage: " << name << std::endl;
+					exit(1);
+				}
+				continue;
+			}
+			if (arg == "-h" || arg == "--help") {
+				std::cout
+				<< "Kernel micro benchmark\n"
+				<< "Usage: ./microbench [OPTIONS] FILE\n"
+				<< "\n"
+				<< "Options:\n"
+				<< "  -k K  --kernel K      : edge_value, advance_ant, route_length, update_edge_pheromone or all. Default: all\n"
+				<< "        --min-time MS   : Minimum time of one sample, sets the iteration count. Default: 10\n"
+				<< "        --samples N     : Timed samples per kernel. Default: 30\n"
+				<< "  -s N  --seed N        : Seed of the synthetic ant states. Default: 1\n"
+				<< "        --edges S       : Per-edge storage: auto, dense or sparse. Default: auto\n";
+				exit(0);
+			}
+			options.problem_path = arg;
+		}
+
+		if (options.problem_path.empty()) {
+			std::cout << "No problem file given" << std::endl;
+			exit(1);
+		}
+		return options;
+	}
+}
+
+int main(int argc, char* argv[]) {
+	Options options = parse(argc, argv);
+
+	Problem problem(options.problem_path);
+	const int n = problem.graph.node_count();
+	std::vector<Ant> ants(n, Ant(0));
+	Route initial_route = nearest_neighbour_route(problem.graph, problem.instance);
+	Parameters params = default_parameters(problem, initial_route);
+
+	KernelBench colony(problem.graph, problem.instance, ants, params);
+	colony.seed(options.seed);
+
+	std::mt19937 generator(options.seed);
+	const Ant& fresh_ant = colony.initial_ants.front();
+
+	/*
+		Synthetic ant states: ants stopped after a random number of steps,
+		so `edge_value` sees realistic mixes of visited and blocked nodes
+	*/
+	std::vector<Ant> partial_ants;
+	std::vector<Route> routes;
+	for (int i = 0; i < 64; i++) {
+		Ant ant = fresh_ant;
+		ant.generator.seed(generator());
+		int steps = std::uniform_int_distribution<int>(0, n - 2)(generator);
+		for (int s = 0; s < n - 1 && ant.current_node != graph::NO_NODE; s++) {
+			if (s == steps) { partial_ants.push_back(ant); }
+			colony.advance_ant(ant);
+		}
+		if (ant.route.nodes.back() == n - 1) { routes.push_back(ant.route); }
+	}
+	if (partial_ants.empty() || routes.empty()) {
+		std::cout << "Could not build synthetic ant states for " << options.problem_path << std::endl;
+		return 1;
+	}
+
+	std::vector<size_t> all_edges;
+	colony.for_all_edges([&](graph::Node, graph::Node, size_t edge) { all_edges.push_back(edge); });
+	std::vector<size_t> edges;
+	for (int i = 0; i < 4096; i++) {
+		edges.push_back(all_edges.at(std::uniform_int_distribution<size_t>(0, all_edges.size() - 1)(generator)));
+	}
+
+	std::cout << "[" << options.problem_path << "] " << n << " nodes, " << problem.graph.edge_count() << " edges, "
+		<< all_edges.size() << " stored " << (colony.sparse_edges ? "sparse" : "dense") << "\n";
+	auto selected = [&](const char* kernel) { return options.kernel == "all" || options.kernel == kernel; };
+	auto nothing = [](size_t) {};
+
+	if (selected("edge_value")) {
+		print(measure("edge_value", options, nothing, [&](size_t ops) {
+			size_t done = 0;
+			while (done < ops) {
+				for (const Ant& ant : partial_ants) {
+					for (const graph::Node* node = problem.graph.begin(ant.current_node); node != problem.graph.end(ant.current_node); node++) {
+						do_not_optimize(colony.edge_value(ant, *node));
+						done++;
+					}
+				}
+			}
+			return done;
+		}));
+	}
+
+	if (selected("advance_ant")) {
+		// One op is a single step, fresh ants are copied untimed before every batch
+		std::vector<Ant> walkers;
+		print(measure("advance_ant", options, [&](size_t ops) {
+			walkers.assign(ops / (n - 1) + 1, fresh_ant);
+			for (Ant& ant : walkers) { ant.generator.seed(generator()); }
+		}, [&](size_t ops) {
+			size_t done = 0;
+			for (Ant& ant : walkers) {
+				for (int s = 0; s < n - 1 && ant.current_node != graph::NO_NODE; s++) {
+					colony.advance_ant(ant);
+					done++;
+				}
+				do_not_optimize(ant.route.nodes.data());
+			}
+			return done;
+		}));
+	}
+
+	if (selected("route_length")) {
+		print(measure("route_length", options, nothing, [&](size_t ops) {
+			size_t done = 0;
+			while (done < ops) {
+				for (const Route& route : routes) {
+					do_not_optimize(colony.route_length(route.nodes));
+					done++;
+				}
+			}
+			return done;
+		}));
+	}
+
+	if (selected("update_edge_pheromone")) {
+		colony.evaporate_pheromone();
+		print(measure("update_edge_pheromone", options, nothing, [&](size_t ops) {
+			size_t done = 0;
+			while (done < ops) {
+				for (size_t edge : edges) {
+					colony.update_edge_pheromone(edge, 1e-6f);
+					done++;
+				}
+				clobber_memory();
+			}
+			return done;
+		}));
+	}
+
+	return 0;
+}
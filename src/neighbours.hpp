@@ -0,0 +1,105 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <vector>
+
+#include "graph.hpp"
+
+/*
+	The `k` nearest nodes of every node by euclidean distance (which orders the same as all
+	TSPLIB 2D metrics), each list sorted by node.
+
+	Nodes are bucketed into a uniform grid and each search visits rings of cells around the node
+	until no unvisited cell can be closer than the k-th neighbour found, so uniformly spread
+	instances take about O(N·k) instead of O(N²).
+*/
+inline std::vector<std::vector<graph::Node>> nearest_neighbours(const std::vector<double>& coordinates, size_t k) {
+	const size_t n = coordinates.size() / 2;
+	std::vector<std::vector<graph::Node>> result(n);
+	k = std::min(k, n > 0 ? n - 1 : 0);
+	if (k == 0) { return result; }
+
+	double min_x = coordinates[0], max_x = coordinates[0], min_y = coordinates[1], max_y = coordinates[1];
+	for (size_t i = 0; i < n; i++) {
+		min_x = std::min(min_x, coordinates[2 * i]);
+		max_x = std::max(max_x, coordinates[2 * i]);
+		min_y = std::min(min_y, coordinates[2 * i + 1]);
+		max_y = std::max(max_y, coordinates[2 * i + 1]);
+	}
+
+	// About two nodes per cell
+	const int side = std::max(1, static_cast<int>(std::sqrt(n / 2.0)));
+	const double cell = std::max({ max_x - min_x, max_y - min_y, 1e-9 }) / side;
+	auto cell_of = [&](double value, double min) {
+		return std::min(side - 1, static_cast<int>((value - min) / cell));
+	};
+
+	// Nodes of cell c are cell_nodes[cell_offsets[c]] .. cell_nodes[cell_offsets[c + 1]]
+	std::vector<size_t> cell_offsets(static_cast<size_t>(side) * side + 1, 0);
+	std::vector<graph::Node> cell_nodes(n);
+	std::vector<int> node_cell(n);
+	for (size_t i = 0; i < n; i++) {
+		node_cell[i] = cell_of(coordinates[2 * i + 1], min_y) * side + cell_of(coordinates[2 * i], min_x);
+		cell_offsets[node_cell[i] + 1]++;
+	}
+	for (size_t c = 1; c < cell_offsets.size(); c++) {
+		cell_offsets[c] += cell_offsets[c - 1];
+	}
+	std::vector<size_t> fill(cell_offsets.begin(), cell_offsets.end() - 1);
+	for (size_t i = 0; i < n; i++) {
+		cell_nodes[fill[node_cell[i]]++] = i;
+	}
+
+	// Max heap of (squared distance, node), the top is the k-th nearest so far
+	std::priority_queue<std::pair<double, graph::Node>> nearest;
+	for (size_t i = 0; i < n; i++) {
+		const double x = coordinates[2 * i], y = coordinates[2 * i + 1];
+		const int cx = node_cell[i] % side, cy = node_cell[i] / side;
+
+		auto visit_cell = [&](int gx, int gy) {
+			if (gx < 0 || gy < 0 || gx >= side || gy >= side) { return; }
+			const size_t c = static_cast<size_t>(gy) * side + gx;
+			for (size_t p = cell_offsets[c]; p < cell_offsets[c + 1]; p++) {
+				const graph::Node other = cell_nodes[p];
+				if (other == static_cast<graph::Node>(i)) { continue; }
+
+				const double dx = coordinates[2 * other] - x, dy = coordinates[2 * other + 1] - y;
+				const double d = dx * dx + dy * dy;
+				if (nearest.size() < k) {
+					nearest.emplace(d, other);
+				}
+				else if (d < nearest.top().first) {
+					nearest.pop();
+					nearest.emplace(d, other);
+				}
+			}
+		};
+
+		for (int r = 0; r < side; r++) {
+			// Every cell at Chebyshev distance r from the node's cell
+			for (int d = -r; d <= r; d++) {
+				visit_cell(cx + d, cy - r);
+				if (r > 0) { visit_cell(cx + d, cy + r); }
+			}
+			for (int d = -r + 1; d <= r - 1; d++) {
+				visit_cell(cx - r, cy + d);
+				visit_cell(cx + r, cy + d);
+			}
+
+			// Cells of the next ring are at least r cells away
+			if (nearest.size() == k && nearest.top().first <= (r * cell) * (r * cell)) { break; }
+		}
+
+		std::vector<graph::Node>& list = result[i];
+		list.reserve(k);
+		while (!nearest.empty()) {
+			list.push_back(nearest.top().second);
+			nearest.pop();
+		}
+		std::sort(list.begin(), list.end());
+	}
+
+	return result;
+}
@@ -1,13 +1,22 @@
+#pragma once
+
+#include <cstdlib>
 #include <fstream>
+#include <sstream>
 #include <string>
-#include <map>
 #include <limits>
+#include <memory>
+#include <vector>
 
 #include <iostream>
 
 #include "graph.hpp"
+#include "instance.hpp"
+#include "memory.hpp"
+#include "problem_cache.hpp"
+#include "neighbours.hpp"
 
-bool read_key(std::string content, std::string key, std::string& value) {
+inline bool read_key(std::string content, std::string key, std::string& value) {
 	if (value.empty() && content.find(key) == 0) {
 		auto p = content.find_first_not_of(": \t", key.size());
 		value = content.substr(p);
@@ -22,16 +31,82 @@ struct Problem {
 
 	std::pair<int, int> bounds;
 
-	graph::DirectedGraph graph;
-	std::map<graph::Edge, int> weights;
-	graph::DirectedGraph dependencies;
+	/*
+		Charged with the nodes of the sets of `graph_sets` while they are built, see --mem-report.
+		Declared first, so it outlives the containers pointing to it. Copies of the problem share it,
+		the copied sets are charged to the counter active at the time of the copy.
+	*/
+	std::shared_ptr<MemoryCounter> graph_memory = std::make_shared<MemoryCounter>();
 
-	Problem(std::string path) : bounds(-1, -1) {
-		std::ifstream file(path);
+	/*
+		Every node pair with a weight (forbidden arcs included), for coordinate instances the neighbour lists.
+		Precedences are read from `instance`.
+	*/
+	graph::Adjacency graph;
+	/*
+		Weights and precedence lists the colonies read from.
+		Points into the memory mapped problem cache or into `storage`.
+	*/
+	InstanceView instance;
+	// True if `instance` points into the problem cache
+	bool cached = false;
+	// Why the instance could not be read, empty if it could. The path constructor exits instead
+	std::string error;
+
+	// Neighbour list length of coordinate instances, `graph` only holds these edges
+	static constexpr int default_neighbours = 16;
+
+private:
+	struct Storage {
+		std::vector<int32_t> weights;
+		std::vector<double> coordinates;
+		std::vector<int32_t> precedence_offsets;
+		std::vector<int32_t> precedence;
+	};
+
+	// Keeps the mapping or the parsed vectors `instance` points to alive, shared by copies
+	std::shared_ptr<const void> storage;
+	// Built by `graph_sets`
+	mutable std::shared_ptr<const graph::DirectedGraph> sets;
+
+	/*
+		Reads an instance from `file`, `source` names it in errors.
+		Sets `error` and returns early on malformed instances.
+	*/
+	void parse(std::istream& file, const std::string& source, int neighbours) {
+		auto parsed = std::make_shared<Storage>();
 		int count = -2;
 		graph::Node i = 0, j = 0;
 		std::string bound_str = "";
+		std::string dimension_str = "";
+		std::string weight_type = "";
+		// Pairs "a b" (a before b) of PRECEDENCE_SECTION, 1 based like NODE_COORD_SECTION
+		std::vector<graph::Edge> precedence_pairs;
+		// Nodes that have to come after each node, ascending as the rows are read in order
+		std::vector<std::vector<graph::Node>> dependents;
+		enum class Section { none, coordinates, precedence } section = Section::none;
 		for (std::string line; std::getline(file, line);) {
+			if (section == Section::coordinates) {
+				std::istringstream values(line);
+				size_t id;
+				double x, y;
+				if (values >> id >> x >> y && id >= 1 && id <= parsed->coordinates.size() / 2) {
+					parsed->coordinates[2 * (id - 1)] = x;
+					parsed->coordinates[2 * (id - 1) + 1] = y;
+					continue;
+				}
+				section = Section::none;
+			}
+			if (section == Section::precedence) {
+				std::istringstream values(line);
+				graph::Node a, b;
+				if (values >> a && a != -1 && values >> b) {
+					precedence_pairs.emplace_back(a - 1, b - 1);
+					continue;
+				}
+				section = Section::none;
+			}
+
 			if (read_key(line, "NAME", name)) { continue; }
 			if (read_key(line, "COMMENT", comment)) { continue; }
 			if (read_key(line, "SOLUTION_BOUNDS", bound_str)) {
@@ -50,41 +125,231 @@ struct Problem {
 				continue;
 			}
 
+			if (read_key(line, "DIMENSION", dimension_str)) { continue; }
+			if (read_key(line, "EDGE_WEIGHT_TYPE", weight_type)) {
+				weight_type = weight_type.substr(0, weight_type.find_last_not_of(" \t\r") + 1);
+				continue;
+			}
+			if (line.rfind("NODE_COORD_SECTION", 0) == 0) {
+				if (dimension_str.empty()) {
+					error = "NODE_COORD_SECTION without DIMENSION in " + source;
+					return;
+				}
+				parsed->coordinates.assign(2 * static_cast<size_t>(std::max(0, std::stoi(dimension_str))), 0.0);
+				section = Section::coordinates;
+				continue;
+			}
+			if (line.rfind("PRECEDENCE_SECTION", 0) == 0) {
+				section = Section::precedence;
+				continue;
+			}
+
 			if (line == "EDGE_WEIGHT_SECTION") {
 				count = -1;
 				continue;
 			}
 			if (count == -1) {
 				count = std::stoi(line);
-				graph = graph::DirectedGraph(count);
-				dependencies = graph::DirectedGraph(count);
+				graph = graph::Adjacency();
+				dependents.assign(std::max(count, 0), {});
+				parsed->weights.assign(static_cast<size_t>(count) * count, InstanceView::NO_EDGE);
 				continue;
 			}
 
 			if (i < count) {
+				// Walks the row once, large generated instances have rows of many thousand numbers
+				const char* position = line.c_str();
 				for (j = 0; j < count; j++) {
-					size_t c;
-					int n = std::stoi(line, &c, 10);
+					char* end;
+					int n = std::strtol(position, &end, 10);
+					if (end == position) {
+						error = "Row " + std::to_string(i + 1) + " of " + source + " has fewer than " + std::to_string(count) + " weights";
+						return;
+					}
 
 					if (i != j) {
 						if (n == -1) {
 							// Dependency
-							dependencies.add_edge(j, i);
+							dependents[j].push_back(i);
 						}
 						else {
-							graph::Edge e(i, j);
-							graph.add_edge(e);
-							weights.emplace(e, n == 1000000 ? std::numeric_limits<int>::max() : n);
+							graph.targets.push_back(j);
+							parsed->weights[static_cast<size_t>(i) * count + j] = n == 1000000 ? std::numeric_limits<int>::max() : n;
 						}
 					}
 
-					line = line.substr(c);
+					position = end;
 				}
 
+				graph.add_row();
 				i++;
 				continue;
 			}
 		}
-		
+
+		if (!parsed->coordinates.empty()) {
+			if (build_coordinate_instance(*parsed, weight_type, precedence_pairs, neighbours)) {
+				storage = parsed;
+			}
+			return;
+		}
+
+		// Rows missing at the end of the file have no arcs
+		while (graph.node_count() < dependents.size()) { graph.add_row(); }
+
+		// CSR of the dependents of every node
+		parsed->precedence_offsets.push_back(0);
+		for (const auto& after : dependents) {
+			parsed->precedence.insert(parsed->precedence.end(), after.begin(), after.end());
+			parsed->precedence_offsets.push_back(parsed->precedence.size());
+		}
+
+		instance.dimension = std::max(count, 0);
+		instance.weights = parsed->weights.data();
+		instance.precedence_offsets = parsed->precedence_offsets.data();
+		instance.precedence = parsed->precedence.data();
+		storage = parsed;
+	}
+
+	/*
+		`graph` becomes the neighbour lists, weights are computed on demand.
+		Like the explicit SOP instances the first node is the start and the last the goal,
+		so every node implicitly depends on the first and the last depends on all others.
+		Returns false and sets `error` if the metric or a precedence is invalid.
+	*/
+	bool build_coordinate_instance(Storage& parsed, const std::string& weight_type, const std::vector<graph::Edge>& precedence_pairs, int neighbours) {
+		const graph::Node n = parsed.coordinates.size() / 2;
+		if (weight_type == "EUC_2D") { instance.metric = InstanceView::Metric::euc_2d; }
+		else if (weight_type == "CEIL_2D") { instance.metric = InstanceView::Metric::ceil_2d; }
+		else if (weight_type == "ATT") { instance.metric = InstanceView::Metric::att; }
+		else {
+			error = "Unsupported EDGE_WEIGHT_TYPE for NODE_COORD_SECTION: " + weight_type;
+			return false;
+		}
+
+		graph::DirectedGraph dependencies(n);
+		for (graph::Node node = 1; node < n - 1; node++) {
+			dependencies.add_edge(0, node);
+			dependencies.add_edge(node, n - 1);
+		}
+		for (const graph::Edge& pair : precedence_pairs) {
+			if (pair.first == pair.second || !dependencies.has_node(pair.first) || !dependencies.has_node(pair.second)) {
+				error = "Invalid precedence " + std::to_string(pair.first + 1) + " " + std::to_string(pair.second + 1);
+				return false;
+			}
+			dependencies.add_edge(pair);
+		}
+
+		parsed.precedence_offsets.push_back(0);
+		for (const auto& dependents : dependencies.adjacency_list) {
+			parsed.precedence.insert(parsed.precedence.end(), dependents.begin(), dependents.end());
+			parsed.precedence_offsets.push_back(parsed.precedence.size());
+		}
+
+		instance.dimension = n;
+		instance.coordinates = parsed.coordinates.data();
+		instance.precedence_offsets = parsed.precedence_offsets.data();
+		instance.precedence = parsed.precedence.data();
+
+		graph = graph::Adjacency();
+		const auto lists = nearest_neighbours(parsed.coordinates, std::max(1, neighbours));
+		for (graph::Node from = 0; from < n; from++) {
+			for (const graph::Node to : lists[from]) {
+				// Nothing goes back to the start
+				if (to != 0) { graph.targets.push_back(to); }
+			}
+			graph.add_row();
+		}
+		return true;
+	}
+
+	void load(const CachedProblem& cache) {
+		name = cache.name;
+		comment = cache.comment;
+		bounds = cache.bounds;
+		instance = cache.instance;
+		storage = cache.mapping;
+		cached = true;
+		build_graph();
+	}
+
+	/*
+		`graph` of an explicit `instance` that points to weights and precedence lists elsewhere,
+		one pass over the matrix
+	*/
+	void build_graph() {
+		const graph::Node n = instance.dimension;
+		graph = graph::Adjacency();
+		graph.offsets.reserve(static_cast<size_t>(n) + 1);
+		for (graph::Node from = 0; from < n; from++) {
+			for (graph::Node to = 0; to < n; to++) {
+				if (from != to && instance.has_edge(from, to)) {
+					graph.targets.push_back(to);
+				}
+			}
+			graph.add_row();
+		}
+		graph.targets.shrink_to_fit();
+	}
+
+public:
+	/*
+		Loads `path` from its problem cache if there is an up to date one,
+		otherwise parses the .sop and writes the cache for the next run.
+		Coordinate instances are not cached, parsing them is linear already.
+	*/
+	Problem(std::string path, int neighbours = default_neighbours) : bounds(-1, -1) {
+		CachedProblem cache;
+		if (load_problem_cache(path, cache)) {
+			load(cache);
+			return;
+		}
+
+		std::ifstream file(path);
+		parse(file, path, neighbours);
+		if (!error.empty()) {
+			std::cout << error << std::endl;
+			exit(1);
+		}
+		if (instance.dimension > 0 && !instance.candidate_lists()) {
+			write_problem_cache(path, name, comment, bounds, instance);
+		}
+	}
+
+	/*
+		Explicit instance whose weights and precedence lists stay where `view` points, e.g. handed over
+		by a program embedding the solver. Only `graph` is built (4 bytes per arc). The arrays have to outlive the problem.
+	*/
+	Problem(const InstanceView& view, std::string name) : name(std::move(name)), bounds(-1, -1), instance(view) {
+		build_graph();
+	}
+
+	/*
+		Parses the instance text in `content`, e.g. sent to the daemon. Never cached.
+		Malformed instances (also ones without nodes) set `error` instead of exiting.
+	*/
+	Problem(std::istream& content, const std::string& source, int neighbours = default_neighbours) : bounds(-1, -1) {
+		try {
+			parse(content, source, neighbours);
+		}
+		catch (const std::exception& e) {
+			// std::stoi on garbage, huge dimensions
+			error = "Could not read " + source + ": " + e.what();
+		}
+		if (error.empty() && instance.dimension <= 0) {
+			error = "No nodes in " + source;
+		}
+	}
+
+	/*
+		`graph` as std::set graph for the GUI, built on the first call and charged to `graph_memory`.
+		Not thread safe, the colonies never need it
+	*/
+	const graph::DirectedGraph& graph_sets() const {
+		if (sets == nullptr) {
+			MemoryScope scope(*graph_memory);
+			sets = std::make_shared<const graph::DirectedGraph>(graph.to_graph());
+		}
+		return *sets;
 	}
-};
\ No newline at end of file
+};
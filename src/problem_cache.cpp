@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "problem_cache.hpp"
+
+namespace {
+	uint64_t align(uint64_t offset) {
+		const uint64_t a = ProblemCacheHeader::alignment;
+		return (offset + a - 1) / a * a;
+	}
+
+	// Size and modification time identify the version of the .sop the cache was built from
+	bool source_stamp(const std::filesystem::path& source, uint64_t& size, int64_t& mtime) {
+		std::error_code error;
+		size = std::filesystem::file_size(source, error);
+		if (error) { return false; }
+		mtime = std::filesystem::last_write_time(source, error).time_since_epoch().count();
+		return !error;
+	}
+
+	void copy_string(char* target, size_t capacity, const std::string& value) {
+		std::memset(target, 0, capacity);
+		std::memcpy(target, value.data(), std::min(capacity - 1, value.size()));
+	}
+}
+
+std::shared_ptr<MappedFile> MappedFile::open(const std::filesystem::path& path) {
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) { return nullptr; }
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return nullptr;
+	}
+
+	void* address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping stays valid after closing
+	close(fd);
+	if (address == MAP_FAILED) { return nullptr; }
+
+	std::shared_ptr<MappedFile> file(new MappedFile());
+	file->address = address;
+	file->length = info.st_size;
+	return file;
+}
+
+MappedFile::~MappedFile() {
+	if (address != nullptr) {
+		munmap(address, length);
+	}
+}
+
+std::filesystem::path problem_cache_path(const std::filesystem::path& source) {
+	return std::filesystem::path(source).replace_extension(".sopbin");
+}
+
+uint64_t checksum(const char* data, size_t size) {
+	uint64_t hash = 0xcbf29ce484222325ull;
+	size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + i, 8);
+		hash = (hash ^ word) * 0x100000001b3ull;
+	}
+	for (; i < size; i++) {
+		hash = (hash ^ static_cast<unsigned char>(data[i])) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+bool load_problem_cache(const std::filesystem::path& source, CachedProblem& result) {
+	uint64_t source_size;
+	int64_t source_mtime;
+	if (!source_stamp(source, source_size, source_mtime)) { return false; }
+
+	std::shared_ptr<MappedFile> file = MappedFile::open(problem_cache_path(source));
+	if (file == nullptr || file->size() < sizeof(ProblemCacheHeader)) { return false; }
+
+	ProblemCacheHeader header;
+	std::memcpy(&header, file->data(), sizeof(header));
+
+	const uint64_t n = header.dimension;
+	if (std::memcmp(header.magic, ProblemCacheHeader::magic_value, sizeof(header.magic)) != 0
+		|| header.version != ProblemCacheHeader::current_version
+		|| header.source_size != source_size || header.source_mtime != source_mtime
+		|| header.file_size != file->size() || header.dimension <= 0
+		|| header.weights_offset + n * n * sizeof(int32_t) > header.file_size
+		|| header.precedence_offsets_offset + (n + 1) * sizeof(int32_t) > header.file_size
+		|| header.precedence_offset + header.precedence_count * sizeof(int32_t) > header.file_size) {
+		return false;
+	}
+
+	const char* payload = file->data() + sizeof(header);
+	if (checksum(payload, file->size() - sizeof(header)) != header.checksum) { return false; }
+
+	InstanceView instance;
+	instance.dimension = header.dimension;
+	instance.weights = reinterpret_cast<const int32_t*>(file->data() + header.weights_offset);
+	instance.precedence_offsets = reinterpret_cast<const int32_t*>(file->data() + header.precedence_offsets_offset);
+	instance.precedence = reinterpret_cast<const int32_t*>(file->data() + header.precedence_offset);
+
+	// The checksum catches corruption, this catches caches that are consistently wrong
+	if (instance.precedence_offsets[0] != 0 || static_cast<uint64_t>(instance.precedence_offsets[n]) != header.precedence_count) { return false; }
+	for (uint64_t node = 0; node < n; node++) {
+		if (instance.precedence_offsets[node] > instance.precedence_offsets[node + 1]) { return false; }
+	}
+	for (uint64_t i = 0; i < header.precedence_count; i++) {
+		if (instance.precedence[i] < 0 || instance.precedence[i] >= header.dimension) { return false; }
+	}
+
+	header.name[sizeof(header.name) - 1] = '\0';
+	header.comment[sizeof(header.comment) - 1] = '\0';
+	result.name = header.name;
+	result.comment = header.comment;
+	result.bounds = std::make_pair(header.bounds[0], header.bounds[1]);
+	result.instance = instance;
+	result.mapping = file;
+	return true;
+}
+
+bool write_problem_cache(const std::filesystem::path& source, const std::string& name, const std::string& comment, std::pair<int, int> bounds, const InstanceView& instance) {
+	ProblemCacheHeader header;
+	std::memset(&header, 0, sizeof(header));
+	if (!source_stamp(source, header.source_size, header.source_mtime)) { return false; }
+
+	const uint64_t n = instance.dimension;
+	std::memcpy(header.magic, ProblemCacheHeader::magic_value, sizeof(header.magic));
+	header.version = ProblemCacheHeader::current_version;
+	header.dimension = instance.dimension;
+	header.bounds[0] = bounds.first;
+	header.bounds[1] = bounds.second;
+	header.precedence_count = instance.precedence_count();
+	header.weights_offset = align(sizeof(header));
+	header.precedence_offsets_offset = align(header.weights_offset + n * n * sizeof(int32_t));
+	header.precedence_offset = align(header.precedence_offsets_offset + (n + 1) * sizeof(int32_t));
+	header.file_size = align(header.precedence_offset + header.precedence_count * sizeof(int32_t));
+	copy_string(header.name, sizeof(header.name), name);
+	copy_string(header.comment, sizeof(header.comment), comment);
+
+	std::vector<char> content(header.file_size, 0);
+	std::memcpy(content.data() + header.weights_offset, instance.weights, n * n * sizeof(int32_t));
+	std::memcpy(content.data() + header.precedence_offsets_offset, instance.precedence_offsets, (n + 1) * sizeof(int32_t));
+	std::memcpy(content.data() + header.precedence_offset, instance.precedence, header.precedence_count * sizeof(int32_t));
+	header.checksum = checksum(content.data() + sizeof(header), content.size() - sizeof(header));
+	std::memcpy(content.data(), &header, sizeof(header));
+
+	// Concurrent runs each write their own file, the last rename wins with an identical cache
+	const std::filesystem::path target = problem_cache_path(source);
+	const std::filesystem::path temporary = target.string() + ".tmp" + std::to_string(getpid());
+	{
+		std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+		file.write(content.data(), content.size());
+		if (!file.good()) {
+			file.close();
+			std::error_code ignored;
+			std::filesystem::remove(temporary, ignored);
+			return false;
+		}
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporary, target, error);
+	if (error) {
+		std::filesystem::remove(temporary, error);
+		return false;
+	}
+	return true;
+}
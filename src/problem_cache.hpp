@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <string>
+
+#include "instance.hpp"
+
+/*
+	Binary problem cache, written next to the .sop the first time it is parsed
+	and memory mapped instead of parsing the text on later runs.
+
+	Layout, native byte order, every section starts at a multiple of `alignment`:
+		ProblemCacheHeader
+		int32 weights[dimension * dimension]         (InstanceView::NO_EDGE where there is no edge)
+		int32 precedence_offsets[dimension + 1]
+		int32 precedence[precedence_count]
+
+	The cache is stale (and rewritten) once size or modification time of the .sop change.
+*/
+struct ProblemCacheHeader {
+	static constexpr char magic_value[8] = { 'S', 'O', 'P', 'C', 'A', 'C', 'H', 'E' };
+	static constexpr uint32_t current_version = 1;
+	static constexpr size_t alignment = 64;
+
+	char magic[8];
+	uint32_t version;
+	int32_t dimension;
+	int32_t bounds[2];
+	uint64_t source_size;
+	int64_t source_mtime;
+	uint64_t file_size;
+	uint64_t weights_offset;
+	uint64_t precedence_offsets_offset;
+	uint64_t precedence_offset;
+	uint64_t precedence_count;
+	// FNV-1a over the 64 bit words of everything after the header
+	uint64_t checksum;
+	char name[128];
+	char comment[256];
+};
+
+/*
+	Read only mapping of a whole file, unmapped when the last reference is gone
+*/
+class MappedFile {
+private:
+	void* address = nullptr;
+	size_t length = 0;
+
+	MappedFile() = default;
+public:
+	// nullptr if the file can not be opened or mapped
+	static std::shared_ptr<MappedFile> open(const std::filesystem::path& path);
+	~MappedFile();
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	const char* data() const { return static_cast<const char*>(address); }
+	size_t size() const { return length; }
+};
+
+struct CachedProblem {
+	std::string name;
+	std::string comment;
+	std::pair<int, int> bounds;
+	// Points into `mapping`
+	InstanceView instance;
+	std::shared_ptr<const MappedFile> mapping;
+};
+
+/*
+	FNV-1a over the 64 bit words of `data` (bytes for the tail), fast enough to hash whole instances
+*/
+uint64_t checksum(const char* data, size_t size);
+
+/*
+	Location of the cache of `source`: problems/ESC25.sop -> problems/ESC25.sopbin
+*/
+std::filesystem::path problem_cache_path(const std::filesystem::path& source);
+
+/*
+	Maps the cache of `source`. Returns false if it is missing, stale or fails validation.
+*/
+bool load_problem_cache(const std::filesystem::path& source, CachedProblem& result);
+
+/*
+	Writes the cache of `source` atomically (temporary file + rename).
+	Returns false if it can not be written, e.g. in a read only directory.
+*/
+bool write_problem_cache(const std::filesystem::path& source, const std::string& name, const std::string& comment, std::pair<int, int> bounds, const InstanceView& instance);
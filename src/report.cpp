@@ -0,0 +1,178 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+
+#include "report.hpp"
+
+std::string print_duration(Profiler::Duration d, bool append_unit) {
+	return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(d).count()) + (append_unit ? " µs" : "");
+}
+
+std::string print_now() {
+	auto current_time = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+	char now_str[std::size("2000-01-01T16:00:00")];
+	std::strftime(now_str, std::size(now_str), "%FT%T", std::gmtime(&current_time));
+	return std::string(now_str);
+}
+
+std::string print_params(Parameters params) {
+	std::string result = "";
+	result += "alpha: " + std::to_string(params.alpha) + ", ";
+	result += "beta: " + std::to_string(params.beta) + ", ";
+	result += "roh: " + std::to_string(params.roh) + ", ";
+	result += "q: " + std::to_string(params.q) + ", ";
+	result += "initial_pheromone: " + std::to_string(params.initial_pheromone) + ", ";
+	result += "min_pheromone: " + std::to_string(params.min_pheromone) + ", ";
+	result += "max_pheromone: " + std::to_string(params.max_pheromone) + ", ";
+	result += "zero_distance: " + std::to_string(params.zero_distance);
+
+	return result;
+}
+
+std::string print_phases(const PhaseTimes& phases) {
+	std::string result = "";
+	for (size_t i = 0; i < static_cast<size_t>(Phase::count); i++) {
+		Phase phase = static_cast<Phase>(i);
+		result += (i > 0 ? ", " : "");
+		result += std::string(phase_name(phase)) + ": " + std::to_string(static_cast<long long>(phases.micros(phase))) + " µs";
+	}
+	return result;
+}
+
+std::string print_counters(const CounterValues& counters) {
+	std::string result = "";
+	for (size_t i = 0; i < static_cast<size_t>(Counter::count); i++) {
+		Counter counter = static_cast<Counter>(i);
+		result += (i > 0 ? ", " : "");
+		result += std::string(counter_name(counter)) + ": " + (counters.has(counter) ? std::to_string(counters.get(counter)) : "n/a");
+	}
+
+	if (counters.has(Counter::cycles) && counters.has(Counter::instructions) && counters.get(Counter::cycles) > 0) {
+		result += ", ipc: " + std::to_string(static_cast<double>(counters.get(Counter::instructions)) / counters.get(Counter::cycles));
+	}
+	return result;
+}
+
+std::string print_bytes(size_t bytes) {
+	const char* units[] = { "B", "KiB", "MiB", "GiB", "TiB" };
+	double value = bytes;
+	size_t unit = 0;
+	while (value >= 1024 && unit + 1 < std::size(units)) {
+		value /= 1024;
+		unit++;
+	}
+
+	char result[32];
+	std::snprintf(result, sizeof(result), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+	return result;
+}
+
+std::string print_memory(const MemoryReport& report) {
+	size_t width = 5;
+	for (const auto& entry : report.entries) {
+		width = std::max(width, entry.first.size());
+	}
+
+	std::string result = "";
+	auto line = [&](const std::string& name, size_t bytes) {
+		result += "  " + name + ":" + std::string(width - name.size() + 1, ' ') + print_bytes(bytes) + "\n";
+	};
+	for (const auto& entry : report.entries) {
+		line(entry.first, entry.second);
+	}
+	line("total", report.total());
+	return result;
+}
+
+MemoryReport problem_memory_usage(const Problem& problem) {
+	MemoryReport report;
+	const size_t instance_bytes = problem.instance.bytes();
+	report.add("graph", vector_bytes(problem.graph.offsets) + vector_bytes(problem.graph.targets));
+	// Set nodes as charged while they were built, only the GUI builds them
+	const size_t sets = problem.graph_memory->bytes.load();
+	if (sets > 0) { report.add("graph (sets)", sets); }
+	report.add(problem.cached ? "instance (mapped)" : "instance", instance_bytes);
+	return report;
+}
+
+void append_profiler(std::filesystem::path path, const Profiler& pf, AntOptimizer* colony, const Problem& problem) {
+	std::ofstream file(path, std::ios::app);
+	auto mm = pf.min_max();
+	file 
+		<< "### " << print_now() << " ###\n"
+		<< "solution=" << colony->best_route.length << "\n"
+		<< "bounds=" << problem.bounds.first << ", " << problem.bounds.second << "\n"
+		<< "rounds=" << pf.rounds() << "\n"
+		<< "total=" << print_duration(pf.total(), true) << "\n"
+		<< "avg=" << print_duration(pf.avg(), true) << "\n"
+		<< "min=" << print_duration(mm.first, true) << "\n"
+		<< "max=" << print_duration(mm.second, true) << "\n"
+		<< "p50=" << print_duration(pf.percentile(0.5), true) << "\n"
+		<< "p90=" << print_duration(pf.percentile(0.9), true) << "\n"
+		<< "p99=" << print_duration(pf.percentile(0.99), true) << "\n"
+		<< "p99.9=" << print_duration(pf.percentile(0.999), true) << "\n"
+		<< "params=" << print_params(colony->params) << "\n"
+		<< "args=" << colony->init_args << "\n"
+		<< "phases=" << print_phases(pf.phase_total()) << "\n";
+
+	// Thread 0 is the one calling `optimize`
+	for (size_t i = 0; i < pf.phases.size(); i++) {
+		file << "phases[" << i << "]=" << print_phases(pf.phases[i]) << "\n";
+	}
+
+	if (!pf.counters.empty()) {
+		file << "counters=" << print_counters(pf.counter_total()) << "\n";
+		for (size_t i = 0; i < pf.counters.size(); i++) {
+			file << "counters[" << i << "]=" << print_counters(pf.counters[i]) << "\n";
+		}
+	}
+	file << "\n";
+}
+
+void append_csv_profiler(std::filesystem::path path, const Profiler& pf, AntOptimizer* colony, const Problem& problem) {
+	bool new_file = !std::filesystem::is_regular_file(path);
+	std::ofstream file(path, std::ios::app);
+	if (new_file) {
+		file << "timestamp;optimizer;rounds;total_µs;avg_µs;min_µs;max_µs;p50_µs;p90_µs;p99_µs;p99.9_µs;solution;bounds_min;bounds_max;";
+		for (size_t i = 0; i < static_cast<size_t>(Phase::count); i++) {
+			file << phase_name(static_cast<Phase>(i)) << "_µs;";
+		}
+		for (size_t i = 0; i < static_cast<size_t>(Counter::count); i++) {
+			file << counter_name(static_cast<Counter>(i)) << ";";
+		}
+		file << "\n";
+	}
+
+	auto mm = pf.min_max();
+	file
+		<< print_now() << ";"
+		<< colony->name() << ":" << colony->init_args << ";"
+		<< pf.rounds() << ";"
+		<< print_duration(pf.total(), false) << ";"
+		<< print_duration(pf.avg(), false) << ";"
+		<< print_duration(mm.first, false) << ";"
+		<< print_duration(mm.second, false) << ";"
+		<< print_duration(pf.percentile(0.5), false) << ";"
+		<< print_duration(pf.percentile(0.9), false) << ";"
+		<< print_duration(pf.percentile(0.99), false) << ";"
+		<< print_duration(pf.percentile(0.999), false) << ";"
+		<< colony->best_route.length << ";"
+		<< problem.bounds.first << ";" << problem.bounds.second << ";";
+
+	// Summed over all threads
+	PhaseTimes phases = pf.phase_total();
+	for (size_t i = 0; i < static_cast<size_t>(Phase::count); i++) {
+		file << static_cast<long long>(phases.micros(static_cast<Phase>(i))) << ";";
+	}
+
+	// Empty unless --perf-counters could open the counter
+	CounterValues counters = pf.counter_total();
+	for (size_t i = 0; i < static_cast<size_t>(Counter::count); i++) {
+		Counter counter = static_cast<Counter>(i);
+		if (counters.has(counter)) { file << counters.get(counter); }
+		file << ";";
+	}
+	file << "\n";
+}
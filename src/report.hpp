@@ -0,0 +1,47 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+
+#include "colonies/base.hpp"
+#include "memory.hpp"
+#include "problem.hpp"
+
+std::string print_duration(Profiler::Duration d, bool append_unit);
+std::string print_now();
+std::string print_params(Parameters params);
+
+/*
+	Time per phase as "reset: 12 µs, construction: 345 µs, ..."
+*/
+std::string print_phases(const PhaseTimes& phases);
+
+/*
+	Counter values as "cycles: 1234, instructions: 2345, ...", missing counters as "n/a"
+*/
+std::string print_counters(const CounterValues& counters);
+
+/*
+	Bytes as "512 B", "12.3 KiB", "4.5 MiB", ...
+*/
+std::string print_bytes(size_t bytes);
+
+/*
+	One indented line per entry followed by the total
+*/
+std::string print_memory(const MemoryReport& report);
+
+/*
+	Bytes of the problem's graphs and weights, shared by all colonies
+*/
+MemoryReport problem_memory_usage(const Problem& problem);
+
+/*
+	Appends a human readable summary of one colony run to `path`
+*/
+void append_profiler(std::filesystem::path path, const Profiler& pf, AntOptimizer* colony, const Problem& problem);
+
+/*
+	Appends one row per colony run to `path`, writes the header if `path` is a new file
+*/
+void append_csv_profiler(std::filesystem::path path, const Profiler& pf, AntOptimizer* colony, const Problem& problem);